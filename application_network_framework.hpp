@@ -2,12 +2,16 @@
 #define APPLICATION_NETWORK_FRAMEWORK_H
 
 #include <memory>
-#include <map>
 #include <vector>
 #include <mutex>
+#include <atomic>
 
 #include "network_handler.h"
+#include "link_table.hpp"
+#include "packet_pool.h"
+#include "handoff.h"
 #include "serialize.hpp"
+#include "static_serialize.hpp"
 #include "log.h"
 #include "old.hpp"
 
@@ -21,11 +25,21 @@
  *      object can not automatic deconstruction by zeroing reference count in only user layer, unless @close framwork method called
  *  3. It is strong recommended to use the @proto_interface framework to serialize or build network packets. 
  *      and than post  the packets by calling framework method @psend, it is simpler and more reliable
+ *      messages declared by @STATIC_PROTO_FIELDS(static_serialize.hpp) can be posted by @psend too, 
+ *      they are encoded without virtual calls and keep the same wire format
  *  4. receive data by overwrite framework virtual method @on_recvdata(const std::string &) associated TCP protocol or 
- *      @on_recvdata(const std::string &, const endpoint &) associated UDP protocol
+ *      @on_recvdata(const std::string &, const endpoint &) associated UDP protocol.
+ *      TCP session can overwrite @on_recvdata(const packet_view &) instead to receive without copy,
+ *      UDP session can overwrite @on_recvdata(const packet_view &, u32_ipv4_t, port_t) for the same purpose,
+ *      the view is borrowed from nshost and invalid after the callback returned,
+ *      use @packet_pool::retain to keep the packet, the result @packet_ptr can be passed to other threads without copy
  *  5. during receive proce, the thread layout of Linux is very difference from MS-WINDOWNS, 
  *      applications do not need to pay special attention to the way these threads are laid out, 
- *      however, it is recommended to switch threads to complete the long time-consuming operations, such as disk-IO or any wait method
+ *      however, it is recommended to switch threads to complete the long time-consuming operations, such as disk-IO or any wait method.
+ *      call @sethandoff(1) on the session before @create(or on the service before @begin, accepted sessions inherit it) to let the framework
+ *      do the switch: every received packet is retained and handled by a worker of @handoff selected by link,
+ *      so the order of packets and @on_disconnected of one session is kept, the worker count is set by @handoff::setworkers.
+ *      with @handoff::setaffinity each worker is pinned to a core, use @post_routine to run timers of the session on the same worker
  *
  *  Terminology:
  *
@@ -42,6 +56,11 @@ namespace nsp {
             return (NULL != package->serialize(dest)) ? 0 : -1;
         }
 
+        template<class M>
+        inline int STD_CALL static_packet_serialize(unsigned char *dest, const void *origin, int cb) {
+            return (NULL != proto::static_serialize(*(const M *) origin, dest)) ? 0 : -1;
+        }
+
         template<class T>
         class tcp_application_service : public obtcp {
             tcp_application_service(HTCPLINK lnk) = delete;
@@ -49,8 +68,21 @@ namespace nsp {
             // finalized the virtual function
             // because inherit class does no need to known how the link created in server.
             virtual void on_accepted(HTCPLINK lnk) override final {
+                accept(lnk);
+            }
 
-                std::shared_ptr<T> sptr = std::make_shared<T>(lnk);
+            void accept(HTCPLINK lnk) {
+                std::shared_ptr<T> sptr;
+                try {
+                    sptr = make_session(lnk);
+                } catch (...) {
+                    ;
+                }
+                if (!sptr) {
+                    return;
+                }
+                // accepted sessions inherit the dispatch mode of the service before any data can arrive
+                sptr->sethandoff(gethandoff());
                 std::weak_ptr<obtcp> wptr = sptr->attach();
                 if (wptr.expired()) {
                     return;
@@ -68,10 +100,8 @@ namespace nsp {
                     return;
                 }
 
-                std::lock_guard < decltype(client_locker_) > guard(client_locker_);
-                auto iter = client_set_.find(lnk);
-                if (client_set_.end() == iter) {
-                    client_set_[lnk] = wptr;
+                if (client_set_.insert(lnk, wptr)) {
+                    invalidate_snapshot();
                 }
             }
 
@@ -80,8 +110,70 @@ namespace nsp {
                 abort();
             }
 
-            std::map<HTCPLINK, std::weak_ptr<obtcp>> client_set_;
-            mutable std::recursive_mutex client_locker_;
+            // sharded, readers(@notify_one, @search_client_by_link, @notify_all) never take a lock
+            link_table<std::weak_ptr<obtcp>> client_set_;
+
+            // the client list iterated by @notify_all, built on demand and dropped by any change of @client_set_,
+            // so that broadcasts without membership change neither allocate nor touch the reference count of each client.
+            // it hold strong references, dropping it on close make sure a closed client is not kept alive by the cache
+            typedef std::vector<std::shared_ptr<T>> client_snapshot;
+            std::shared_ptr<const client_snapshot> snapshot_;
+            std::atomic<uint64_t> snapshot_version_{0};
+            std::atomic<int> snapshot_cached_{0};
+            std::mutex snapshot_locker_;
+
+            void invalidate_snapshot() {
+                std::shared_ptr<const client_snapshot> previous;
+                ++snapshot_version_;
+                // nothing to drop, the usual case of accept storm when no broadcast is running
+                if (0 == snapshot_cached_) {
+                    return;
+                }
+                {
+                    std::lock_guard < decltype(snapshot_locker_) > guard(snapshot_locker_);
+                    previous.swap(snapshot_);
+                    snapshot_cached_ = 0;
+                }
+                // the last reference of the snapshot may release clients, do it out of the lock
+            }
+
+            std::shared_ptr<const client_snapshot> snapshot() {
+                {
+                    std::lock_guard < decltype(snapshot_locker_) > guard(snapshot_locker_);
+                    if (snapshot_) {
+                        return snapshot_;
+                    }
+                }
+
+                uint64_t version = snapshot_version_;
+                std::shared_ptr<client_snapshot> built = std::make_shared<client_snapshot>();
+                std::vector<HTCPLINK> expired;
+                client_set_.for_each([&](const HTCPLINK lnk, const std::weak_ptr<obtcp> &wptr) {
+                    auto obptr = wptr.lock();
+                    if (obptr) {
+                        built->push_back(std::static_pointer_cast< T >(obptr));
+                    } else {
+                        expired.push_back(lnk);
+                    }
+                });
+                // the table can not be modified inside @for_each
+                for (HTCPLINK lnk : expired) {
+                    client_set_.erase(lnk);
+                }
+
+                // cache it only if nothing changed during the build, otherwise use it for this time only
+                // the flag is raised before the version check, so an invalidation either see the flag or fail this check
+                std::lock_guard < decltype(snapshot_locker_) > guard(snapshot_locker_);
+                if (!snapshot_) {
+                    snapshot_cached_ = 1;
+                    if (version == snapshot_version_) {
+                        snapshot_ = built;
+                    } else {
+                        snapshot_cached_ = 0;
+                    }
+                }
+                return built;
+            }
 
         public:
             tcp_application_service() : obtcp() {
@@ -92,51 +184,51 @@ namespace nsp {
                 close();
             }
 
-            // begin the services
-            int begin(const endpoint &ep) {
-                return ( (create(ep) >= 0) ? listen() : -1);
+        protected:
+            // factory of the accepted sessions, called on nshost I/O thread for each accepted link.
+            // overwrite it to take objects from a preallocated pool, e.g. return std::allocate_shared<T>(pool_allocator, lnk),
+            // return nullptr to leave the link without session object
+            virtual std::shared_ptr<T> make_session(const HTCPLINK lnk) {
+                return std::make_shared<T>(lnk);
+            }
+
+        public:
+
+            // begin the services, @backlog is the pending connections queue length of the listener.
+            // SO_REUSEPORT multi-listener is not offered: nshost bind the socket inside @tcp_create, before any option can be set
+            int begin(const endpoint &ep, int backlog = 5) {
+                return ( (create(ep) >= 0) ? listen(backlog) : -1);
             }
 
-            int begin(const char *epstr) {
+            int begin(const char *epstr, int backlog = 5) {
                 if (!epstr)
                     return -1;
                 endpoint ep;
                 if (endpoint::build(epstr, ep) < 0) {
                     return -1;
                 }
-                return begin(ep);
+                return begin(ep, backlog);
             }
 
             // the notification from client closed event
             void on_client_closed(const HTCPLINK lnk) {
-                std::lock_guard < decltype(client_locker_) > guard(client_locker_);
-                auto iter = client_set_.find(lnk);
-                if (client_set_.end() != iter) {
-                    client_set_.erase(iter);
+                if (client_set_.erase(lnk)) {
+                    invalidate_snapshot();
                 }
             }
 
             int notify_one(HTCPLINK lnk, const std::function<int( const std::shared_ptr<T> &client)> &todo) {
-                std::shared_ptr<T> client;
-                {
-                    std::lock_guard < decltype(client_locker_) > guard(client_locker_);
-                    auto iter = client_set_.find(lnk);
-                    if (client_set_.end() == iter) {
-                        return -1;
-                    }
-
-                    if (iter->second.expired()) {
-                        return -1;
-                    }
-
-                    auto obptr = iter->second.lock();
-                    if (!obptr) {
-                        client_set_.erase(iter);
-                        return -1;
-                    }
+                std::weak_ptr<obtcp> wptr;
+                if (!client_set_.search(lnk, wptr)) {
+                    return -1;
+                }
 
-                    client = std::static_pointer_cast< T >(obptr);
+                auto obptr = wptr.lock();
+                if (!obptr) {
+                    client_set_.erase(lnk);
+                    return -1;
                 }
+                std::shared_ptr<T> client = std::static_pointer_cast< T >(obptr);
 
                 if (todo) {
                     return todo(client);
@@ -144,37 +236,47 @@ namespace nsp {
                 return -1;
             }
 
+            // broadcast over the cached client list, @todo can safely close clients or accept new ones,
+            // the changes take effect on the next broadcast
             void notify_all(const std::function<void( const std::shared_ptr<T> &client)> &todo) {
-                std::vector<std::weak_ptr < obtcp>> duplicated;
-                {
-                    std::lock_guard < decltype(client_locker_) > guard(client_locker_);
-                    auto iter = client_set_.begin();
-                    while (client_set_.end() != iter) {
-                        if (iter->second.expired()) {
-                            iter = client_set_.erase(iter);
-                        } else {
-                            duplicated.push_back(iter->second);
-                            ++iter;
-                        }
-                    }
+                if (!todo) {
+                    return;
                 }
 
-                for (auto &iter : duplicated) {
-                    auto obptr = iter.lock();
-                    std::shared_ptr<T> client = std::static_pointer_cast< T >(obptr);
-                    if (client && todo) {
-                        todo(client);
-                    }
+                std::shared_ptr<const client_snapshot> clients = snapshot();
+                for (const auto &client : *clients) {
+                    todo(client);
+                }
+            }
+
+            // send the same packet to every client, @package is serialized only once into a pooled buffer shared by all sends.
+            // the frame head is still built per link(by nshost or by the link itself in batch/cork mode), it is only a few bytes.
+            // return the count of clients which accepted the packet
+            int broadcast(const proto::proto_interface *package) {
+                if (!package) {
+                    return -1;
+                }
+
+                packet_ptr pkt = packet_pool::acquire(package->length());
+                if (!pkt || pkt.size() <= 0 || !package->serialize(pkt.data())) {
+                    return -1;
                 }
 
+                int sent = 0;
+                std::shared_ptr<const client_snapshot> clients = snapshot();
+                for (const auto &client : *clients) {
+                    if (client->send(pkt.data(), pkt.size()) >= 0) {
+                        ++sent;
+                    }
+                }
+                return sent;
             }
 
             // search a client object by it's HTCPLINK flag
             int search_client_by_link(const HTCPLINK lnk, std::shared_ptr<T> &client) const {
-                std::lock_guard < decltype(client_locker_) > guard(client_locker_);
-                auto iter = client_set_.find(lnk);
-                if (client_set_.end() != iter) {
-                    client = std::static_pointer_cast< T >(iter->second.lock());
+                std::weak_ptr<obtcp> wptr;
+                if (client_set_.search(lnk, wptr)) {
+                    client = std::static_pointer_cast< T >(wptr.lock());
                     return 0;
                 } else {
                     return -1;
@@ -216,6 +318,12 @@ namespace nsp {
                 return obtcp::send(package, package->length(), &nsp::tcpip::packet_serialize);
             }
 
+            // send message declared by @STATIC_PROTO_FIELDS, it is encoded directly into the send buffer without virtual call
+            template<class M>
+            auto psend(const M &msg) -> decltype(msg.static_fields(), int()) {
+                return obtcp::send(&msg, proto::static_length(msg), &nsp::tcpip::static_packet_serialize<M>);
+            }
+
             virtual void bind_object(const std::shared_ptr<obtcp> &object) override final {
                 tcp_application_server_ = std::static_pointer_cast< tcp_application_service<tcp_application_client < T>> >(object);
             }
@@ -267,6 +375,32 @@ namespace nsp {
 
                 return obudp::sendto(package, package->length(), ep, &nsp::tcpip::packet_serialize);
             }
+
+            template<class M>
+            auto psend(const M &msg, const endpoint &ep) -> decltype(msg.static_fields(), int()) {
+                return obudp::sendto(&msg, proto::static_length(msg), ep, &nsp::tcpip::static_packet_serialize<M>);
+            }
+
+            // send the same packet to a group of endpoints(multicast fan-out), the packet is serialized only once,
+            // then written to each endpoint by @sendto(one nshost write per datagram). return the count of datagrams accepted
+            int psend(const proto::proto_interface *package, const std::vector<endpoint> &eps) {
+                if (!package || eps.empty()) {
+                    return -1;
+                }
+
+                packet_ptr pkt = packet_pool::acquire(package->length());
+                if (!pkt || !package->serialize(pkt.data())) {
+                    return -1;
+                }
+
+                int sent = 0;
+                for (const endpoint &ep : eps) {
+                    if (obudp::sendto(pkt.data(), pkt.size(), ep) >= 0) {
+                        ++sent;
+                    }
+                }
+                return sent;
+            }
         };
 
         typedef udp_application_client udp_application_server;
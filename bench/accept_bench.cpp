@@ -0,0 +1,184 @@
+﻿/*
+ *  sustained accept rate of @tcp_application_service, only the framework side is measured:
+ *  @make_session, @obtcp::attach(swnet link table insert), the client registry insert and @invalidate_snapshot on accept,
+ *  swnet detach, registry erase and @invalidate_snapshot on close. nshost is replaced by the stubs below
+ *
+ *  build:  gcc -c -O2 -D_GNU_SOURCE -I../icom ../com/[a-z]*.c
+ *          g++ -std=c++11 -O2 -DSTD_CALL= -I.. accept_bench.cpp ../network_handler.cpp ../swnet.cpp ../handoff.cpp \
+ *              ../packet_pool.cpp ../link_timer.cpp ../latency_histogram.cpp ../endpoint.cpp ../os_util.cpp \
+ *              ../toolkit.cpp ../encrypt.cpp *.o -o accept_bench -lpthread -ldl -lcrypt
+ *  usage:  ./accept_bench [links]
+ *
+ *  the registry is filled to 1/16, 1/4 and all of @links, a flat ns/accept over the sizes shows the accept path is O(1).
+ *  the "broadcasting" rows call @notify_all every 256 accepts(and closes), so that each change has a cached snapshot to drop,
+ *  they include the O(n) rebuild of the snapshot by @notify_all itself
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include "application_network_framework.hpp"
+#include "icom/nis.h"
+
+///////////////////////////////////////		nshost stubs ///////////////////////////////////////
+static std::atomic<HTCPLINK> next_link{1};
+
+int tcp_init() {
+    return 0;
+}
+
+HTCPLINK tcp_create(tcp_io_callback_t callback, const char* ipstr, uint16_t port) {
+    return next_link++;
+}
+
+void tcp_destroy(HTCPLINK link) {
+    ;
+}
+
+int tcp_connect(HTCPLINK link, const char* ipstr, uint16_t port) {
+    return 0;
+}
+
+int tcp_connect2(HTCPLINK link, const char* ipstr, uint16_t port) {
+    return 0;
+}
+
+int tcp_listen(HTCPLINK link, int block) {
+    return 0;
+}
+
+int tcp_write(HTCPLINK link, const void *origin, int size, const nis_serializer_t serializer) {
+    return 0;
+}
+
+int tcp_awaken(HTCPLINK link, const void *pipedata, int cb) {
+    return 0;
+}
+
+int tcp_getaddr(HTCPLINK link, int type, uint32_t* ip, uint16_t* port) {
+    *ip = 0x0100007F;
+    *port = 10000;
+    return 0;
+}
+
+int tcp_getopt(HTCPLINK link, int level, int opt, char *val, int *len) {
+    return -1;
+}
+
+int tcp_settst(HTCPLINK link, const tst_t *tst) {
+    return 0;
+}
+
+int tcp_setattr(HTCPLINK link, int cmd, int enable) {
+    return 0;
+}
+
+int udp_init() {
+    return 0;
+}
+
+HUDPLINK udp_create(udp_io_callback_t user_callback, const char* ipstr, uint16_t port, int flag) {
+    return INVALID_HUDPLINK;
+}
+
+void udp_destroy(HUDPLINK link) {
+    ;
+}
+
+int udp_write(HUDPLINK link, const void *origin, int cb, const char* ipstr, uint16_t port, const nis_serializer_t serializer) {
+    return -1;
+}
+
+int udp_getaddr(HUDPLINK link, uint32_t *ipv4, uint16_t *port) {
+    return -1;
+}
+
+int nis_gethost(const char *name, uint32_t *ipv4) {
+    return -1;
+}
+
+nis_event_callback_t nis_checr(const nis_event_callback_t ecr) {
+    return nullptr;
+}
+
+///////////////////////////////////////		bench ///////////////////////////////////////
+using namespace nsp::tcpip;
+
+class session : public tcp_application_client<nsp::proto::nspdef::protocol> {
+public:
+    session(HTCPLINK lnk) : tcp_application_client<nsp::proto::nspdef::protocol>(lnk) {
+        ;
+    }
+};
+
+typedef tcp_application_service<session> service;
+
+static double elapsed_ns(const std::chrono::steady_clock::time_point &begin, const std::chrono::steady_clock::time_point &end) {
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+}
+
+static void run(const std::shared_ptr<service> &srv, const HTCPLINK listener, const int links, const bool broadcasting, const bool report = true) {
+    HTCPLINK first = next_link;
+    next_link += links;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < links; i++) {
+        // the overloads of obtcp are hidden by the overrides of the service and the session
+        static_cast<obtcp &> (*srv).on_accepted(listener, first + i);
+        if (broadcasting && 0 == (i & 255)) {
+            srv->notify_all([&] (const std::shared_ptr<session> &client) {
+                ;
+            });
+        }
+    }
+    auto middle = std::chrono::steady_clock::now();
+
+    // the close notification of nshost arrive with the object pinned by swnet, hold the objects out of the timing
+    std::vector<std::shared_ptr<session>> clients;
+    clients.reserve(links);
+    srv->notify_all([&] (const std::shared_ptr<session> &client) {
+        clients.push_back(client);
+    });
+
+    auto closing = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < clients.size(); i++) {
+        static_cast<obtcp &> (*clients[i]).on_closed();
+        if (broadcasting && 0 == (i & 255)) {
+            srv->notify_all([&] (const std::shared_ptr<session> &client) {
+                ;
+            });
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (!report) {
+        return;
+    }
+    printf("%8d links %-12s accept %7.1f ns  %9.0f/s   close %7.1f ns  %9.0f/s\n", links, broadcasting ? "broadcasting" : "idle",
+            elapsed_ns(begin, middle) / links, links * 1e9 / elapsed_ns(begin, middle),
+            elapsed_ns(closing, end) / clients.size(), clients.size() * 1e9 / elapsed_ns(closing, end));
+}
+
+int main(int argc, char **argv) {
+    int links = ((argc > 1) ? atoi(argv[1]) : 100000);
+
+    auto srv = std::make_shared<service>();
+    HTCPLINK listener = next_link;
+    if (srv->begin("0.0.0.0:10000") < 0) {
+        printf("failed to begin the service\n");
+        return 1;
+    }
+
+    // warm up the allocator and the link tables
+    run(srv, listener, links / 16, false, false);
+
+    for (int size : {links / 16, links / 4, links}) {
+        run(srv, listener, size, false);
+        run(srv, listener, size, true);
+    }
+    return 0;
+}
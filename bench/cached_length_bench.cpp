@@ -0,0 +1,187 @@
+﻿/*
+ *  @proto_cached_t on nested vector-of-struct payloads, encode as @psend does it: @length of the whole message, then @serialize
+ *
+ *  build:  g++ -std=c++11 -O2 -DSTD_CALL= -I.. cached_length_bench.cpp -o cached_length_bench
+ *  usage:  ./cached_length_bench [messages] [rounds]
+ *
+ *  the payload is a vector of 32 items, each item hold a label and a vector of 8 samples, each sample hold a tag string.
+ *  three cases, each one run with plain items and with proto_cached_t items:
+ *      fresh   : every message is built by code and encoded once. nothing is cached yet, so the tree is still walked twice
+ *                (first @length, then @serialize), proto_cached_t can not help and only add it's own check
+ *      resend  : the same message is encoded again and again, @length of each cached item is O(1) after the first time
+ *      forward : a received message(@build) is encoded, the length of each cached item is known from the bytes it consumed
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+#include "serialize.hpp"
+
+using namespace nsp::proto;
+
+struct sample : public proto_interface {
+    proto_crt_t<uint32_t> time_;
+    proto_crt_t<double> value_;
+    proto_string_t<char> tag_;
+
+    virtual const int length() const override {
+        return time_.length() + value_.length() + tag_.length();
+    }
+
+    virtual unsigned char *serialize(unsigned char *bytes) const override {
+        unsigned char *pos = time_.serialize(bytes);
+        pos = value_.serialize(pos);
+        return tag_.serialize(pos);
+    }
+
+    virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+        const unsigned char *pos = time_.build(bytes, cb);
+        if (pos) pos = value_.build(pos, cb);
+        if (pos) pos = tag_.build(pos, cb);
+        return pos;
+    }
+};
+
+struct item : public proto_interface {
+    proto_crt_t<uint32_t> index_;
+    proto_string_t<char> label_;
+    proto_vector_t<sample> samples_;
+
+    virtual const int length() const override {
+        return index_.length() + label_.length() + samples_.length();
+    }
+
+    virtual unsigned char *serialize(unsigned char *bytes) const override {
+        unsigned char *pos = index_.serialize(bytes);
+        pos = label_.serialize(pos);
+        return samples_.serialize(pos);
+    }
+
+    virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+        const unsigned char *pos = index_.build(bytes, cb);
+        if (pos) pos = label_.build(pos, cb);
+        if (pos) pos = samples_.build(pos, cb);
+        return pos;
+    }
+};
+
+template<class E>
+struct report : public proto_interface {
+    proto_crt_t<uint32_t> id_;
+    proto_vector_t<E> items_;
+
+    virtual const int length() const override {
+        return id_.length() + items_.length();
+    }
+
+    virtual unsigned char *serialize(unsigned char *bytes) const override {
+        return items_.serialize(id_.serialize(bytes));
+    }
+
+    virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+        const unsigned char *pos = id_.build(bytes, cb);
+        return (pos ? items_.build(pos, cb) : nullptr);
+    }
+};
+
+static item make_item(const int i) {
+    item it;
+    it.index_ = i;
+    it.label_ = "channel-" + std::to_string(i);
+    for (int j = 0; j < 8; j++) {
+        sample s;
+        s.time_ = j;
+        s.value_ = i * 0.25 + j;
+        s.tag_ = "t" + std::to_string(j);
+        it.samples_.push_back(s);
+    }
+    return it;
+}
+
+static void fill(report<item> &msg) {
+    msg.id_ = 1;
+    for (int i = 0; i < 32; i++) {
+        msg.items_.push_back(make_item(i));
+    }
+}
+
+static void fill(report<proto_cached_t<item>> &msg) {
+    msg.id_ = 1;
+    for (int i = 0; i < 32; i++) {
+        msg.items_.push_back(proto_cached_t<item>(make_item(i)));
+    }
+}
+
+// the message is reached through a pointer like @psend does
+static const proto_interface *volatile opaque = nullptr;
+static uint64_t sink = 0;
+
+static void encode(const proto_interface *msg, std::vector<unsigned char> &buffer) {
+    opaque = msg;
+    buffer.resize(opaque->length());
+    opaque->serialize(buffer.data());
+    sink += buffer.back();
+}
+
+static double ns_per(const std::chrono::steady_clock::time_point &begin, const std::chrono::steady_clock::time_point &end, const int count) {
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / count;
+}
+
+template<class E>
+static void run(const char *name, const int messages, const int rounds, const bool report_result = true) {
+    std::vector<unsigned char> buffer;
+
+    // fresh: built out of the timing, encoded once each
+    std::vector<std::unique_ptr<report<E>>> fresh;
+    for (int i = 0; i < messages; i++) {
+        fresh.emplace_back(new report<E>);
+        fill(*fresh.back());
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto &msg : fresh) {
+        encode(msg.get(), buffer);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    // resend: the first of them again
+    for (int i = 0; i < rounds; i++) {
+        encode(fresh.front().get(), buffer);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    // forward: messages built from the received bytes
+    std::vector<unsigned char> received(buffer);
+    std::vector<std::unique_ptr<report<E>>> forward;
+    for (int i = 0; i < messages; i++) {
+        forward.emplace_back(new report<E>);
+        int cb = (int) received.size();
+        forward.back()->build(received.data(), cb);
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    for (auto &msg : forward) {
+        encode(msg.get(), buffer);
+    }
+    auto t4 = std::chrono::steady_clock::now();
+
+    if (report_result) {
+        printf("%-20s %6d bytes  fresh %8.1f ns  resend %8.1f ns  forward %8.1f ns\n", name, (int) buffer.size(),
+                ns_per(t0, t1, messages), ns_per(t1, t2, rounds), ns_per(t3, t4, messages));
+    }
+}
+
+int main(int argc, char **argv) {
+    int messages = ((argc > 1) ? atoi(argv[1]) : 2000);
+    int rounds = ((argc > 2) ? atoi(argv[2]) : 20000);
+
+    // first round warms caches up
+    run<item>("plain items", messages / 10, rounds / 10, false);
+    run<proto_cached_t<item>>("proto_cached_t items", messages / 10, rounds / 10, false);
+
+    run<item>("plain items", messages, rounds);
+    run<proto_cached_t<item>>("proto_cached_t items", messages, rounds);
+    return (int) (sink & 0);
+}
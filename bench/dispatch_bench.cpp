@@ -0,0 +1,239 @@
+﻿/*
+ *  per-event dispatch cost of @swnet, measured through the real code: the io callback registered to nshost by @swnet::tcp_create
+ *  (and @udp_create) is called with the receive events nshost would raise, so each event pays @tcp_io, the link table lookup of
+ *  @tcp_refobj, @obtcp::on_recvdata and @deliver(counters, flush and watermark check) up to the virtual @on_recvdata of the session.
+ *  nshost is replaced by the stubs below, which keep the callbacks and hand out the link handles
+ *
+ *  build:  gcc -c -O2 -D_GNU_SOURCE -I../icom ../com/[a-z]*.c
+ *          g++ -std=c++11 -O2 -DSTD_CALL= -I.. dispatch_bench.cpp ../network_handler.cpp ../swnet.cpp ../handoff.cpp \
+ *              ../packet_pool.cpp ../link_timer.cpp ../latency_histogram.cpp ../endpoint.cpp ../os_util.cpp \
+ *              ../toolkit.cpp ../encrypt.cpp *.o -o dispatch_bench -lpthread -ldl -lcrypt
+ *  usage:  ./dispatch_bench [links] [events]
+ *
+ *  the rows are: tcp receive, tcp receive with @swnet::setlatency, tcp events of unknown links(lookup miss), udp receive.
+ *  links are picked at random over @links so that the lookups are not served by one hot cache line
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include "swnet.h"
+#include "icom/nis.h"
+
+///////////////////////////////////////		nshost stubs ///////////////////////////////////////
+static std::atomic<HLNK> next_link{1};
+static tcp_io_callback_t tcp_callback = nullptr;
+static udp_io_callback_t udp_callback = nullptr;
+
+int tcp_init() {
+    return 0;
+}
+
+HTCPLINK tcp_create(tcp_io_callback_t callback, const char* ipstr, uint16_t port) {
+    tcp_callback = callback;
+    return next_link++;
+}
+
+void tcp_destroy(HTCPLINK link) {
+    ;
+}
+
+int tcp_connect(HTCPLINK link, const char* ipstr, uint16_t port) {
+    return 0;
+}
+
+int tcp_connect2(HTCPLINK link, const char* ipstr, uint16_t port) {
+    return 0;
+}
+
+int tcp_listen(HTCPLINK link, int block) {
+    return 0;
+}
+
+int tcp_write(HTCPLINK link, const void *origin, int size, const nis_serializer_t serializer) {
+    return 0;
+}
+
+int tcp_awaken(HTCPLINK link, const void *pipedata, int cb) {
+    return 0;
+}
+
+int tcp_getaddr(HTCPLINK link, int type, uint32_t* ip, uint16_t* port) {
+    *ip = 0x0100007F;
+    *port = 10000;
+    return 0;
+}
+
+int tcp_getopt(HTCPLINK link, int level, int opt, char *val, int *len) {
+    return -1;
+}
+
+int tcp_settst(HTCPLINK link, const tst_t *tst) {
+    return 0;
+}
+
+int tcp_setattr(HTCPLINK link, int cmd, int enable) {
+    return 0;
+}
+
+int udp_init() {
+    return 0;
+}
+
+HUDPLINK udp_create(udp_io_callback_t user_callback, const char* ipstr, uint16_t port, int flag) {
+    udp_callback = user_callback;
+    return next_link++;
+}
+
+void udp_destroy(HUDPLINK link) {
+    ;
+}
+
+int udp_write(HUDPLINK link, const void *origin, int cb, const char* ipstr, uint16_t port, const nis_serializer_t serializer) {
+    return 0;
+}
+
+int udp_getaddr(HUDPLINK link, uint32_t *ipv4, uint16_t *port) {
+    *ipv4 = 0x0100007F;
+    *port = 10001;
+    return 0;
+}
+
+int nis_gethost(const char *name, uint32_t *ipv4) {
+    return -1;
+}
+
+nis_event_callback_t nis_checr(const nis_event_callback_t ecr) {
+    return nullptr;
+}
+
+///////////////////////////////////////		bench ///////////////////////////////////////
+using namespace nsp::tcpip;
+
+class tcp_session : public obtcp {
+public:
+    uint64_t bytes_ = 0;
+
+    HTCPLINK handle() const {
+        return lnk_;
+    }
+
+    virtual void on_recvdata(const packet_view &pkt) override {
+        bytes_ += pkt.size();
+    }
+};
+
+class udp_session : public obudp {
+public:
+    uint64_t bytes_ = 0;
+
+    HUDPLINK handle() const {
+        return lnk_;
+    }
+
+    virtual void on_recvdata(const packet_view &data, const u32_ipv4_t ipv4, const port_t port) override {
+        bytes_ += data.size();
+    }
+};
+
+static uint64_t next_handle(uint64_t &seed, const std::size_t links) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed % (uint64_t) links;
+}
+
+static double ns_per(const std::chrono::steady_clock::time_point &begin, const std::chrono::steady_clock::time_point &end, const int events) {
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / events;
+}
+
+static double tcp_receive(const std::vector<HTCPLINK> &handles, const int events) {
+    unsigned char packet[64] = {0};
+    tcp_data_t data;
+    data.e.Packet.Data = packet;
+    data.e.Packet.Size = sizeof (packet);
+    nis_event_t evt;
+    evt.Event = EVT_RECEIVEDATA;
+
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < events; i++) {
+        evt.Ln.Tcp.Link = handles[next_handle(seed, handles.size())];
+        tcp_callback(&evt, &data);
+    }
+    return ns_per(begin, std::chrono::steady_clock::now(), events);
+}
+
+static double udp_receive(const std::vector<HUDPLINK> &handles, const int events) {
+    unsigned char packet[64] = {0};
+    udp_data_t data;
+    data.e.Packet.Data = packet;
+    data.e.Packet.Size = sizeof (packet);
+    strcpy(data.e.Packet.RemoteAddress, "127.0.0.1");
+    data.e.Packet.RemotePort = 10002;
+    nis_event_t evt;
+    evt.Event = EVT_RECEIVEDATA;
+
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < events; i++) {
+        evt.Ln.Udp.Link = handles[next_handle(seed, handles.size())];
+        udp_callback(&evt, &data);
+    }
+    return ns_per(begin, std::chrono::steady_clock::now(), events);
+}
+
+int main(int argc, char **argv) {
+    int links = ((argc > 1) ? atoi(argv[1]) : 10000);
+    int events = ((argc > 2) ? atoi(argv[2]) : 10000000);
+
+    std::vector<std::shared_ptr<tcp_session>> tcp_sessions;
+    std::vector<HTCPLINK> tcp_handles;
+    std::vector<HTCPLINK> unknown_handles;
+    std::vector<std::shared_ptr<udp_session>> udp_sessions;
+    std::vector<HUDPLINK> udp_handles;
+    for (int i = 0; i < links; i++) {
+        auto tcp = std::make_shared<tcp_session>();
+        if (tcp->create() < 0) {
+            printf("failed to create tcp link\n");
+            return 1;
+        }
+        tcp_handles.push_back(tcp->handle());
+        tcp_sessions.push_back(tcp);
+
+        auto udp = std::make_shared<udp_session>();
+        if (udp->create() < 0) {
+            printf("failed to create udp link\n");
+            return 1;
+        }
+        udp_handles.push_back(udp->handle());
+        udp_sessions.push_back(udp);
+    }
+    for (int i = 0; i < links; i++) {
+        unknown_handles.push_back(next_link++);
+    }
+
+    // first round warms caches up
+    for (int round = 0; round < 2; round++) {
+        swnet::setlatency(0);
+        double receive = tcp_receive(tcp_handles, events);
+        double miss = tcp_receive(unknown_handles, events);
+        swnet::setlatency(1);
+        double timed = tcp_receive(tcp_handles, events);
+        swnet::setlatency(0);
+        double datagram = udp_receive(udp_handles, events);
+
+        if (round > 0) {
+            printf("tcp receive               %6.1f ns/event\n", receive);
+            printf("tcp receive, latency on   %6.1f ns/event\n", timed);
+            printf("tcp unknown link          %6.1f ns/event\n", miss);
+            printf("udp receive               %6.1f ns/event\n", datagram);
+        }
+    }
+    return 0;
+}
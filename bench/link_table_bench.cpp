@@ -0,0 +1,114 @@
+﻿/*
+ *  lookup throughput of @link_table against the recursive_mutex + unordered_map it replaced in @swnet
+ *
+ *  build:  g++ -std=c++11 -O2 -I.. link_table_bench.cpp -o link_table_bench -lpthread
+ *  usage:  ./link_table_bench [links] [lookups per thread]
+ *
+ *  every dispatch thread looks up random handles, one extra thread keeps detach/attach a handle
+ *  to simulate the connection churn. reported as ns per lookup and total lookups per second.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+
+#include "link_table.hpp"
+
+using namespace nsp::tcpip;
+
+struct map_table {
+    mutable std::recursive_mutex lock_;
+    std::unordered_map<HLNK, std::shared_ptr<int>> map_;
+
+    bool search(const HLNK lnk, std::shared_ptr<int> &value) const {
+        std::lock_guard < decltype(lock_) > guard(lock_);
+        auto iter = map_.find(lnk);
+        if (map_.end() == iter) {
+            return false;
+        }
+        value = iter->second;
+        return true;
+    }
+
+    bool insert(const HLNK lnk, const std::shared_ptr<int> &value) {
+        std::lock_guard < decltype(lock_) > guard(lock_);
+        return map_.insert(std::make_pair(lnk, value)).second;
+    }
+
+    bool erase(const HLNK lnk) {
+        std::lock_guard < decltype(lock_) > guard(lock_);
+        return map_.erase(lnk) > 0;
+    }
+};
+
+template<class Table>
+static void run(const char *name, Table &table, int links, int threads, int lookups) {
+    // one object per link like sessions, so readers do not share a reference counter
+    for (int i = 0; i < links; i++) {
+        table.insert((HLNK) i, std::make_shared<int>(i));
+    }
+    std::shared_ptr<int> object = std::make_shared<int>(0);
+
+    std::atomic<int> stop{0};
+    std::atomic<uint64_t> found{0};
+    std::thread churn([&] {
+        HLNK lnk = (HLNK) links;
+        while (0 == stop.load(std::memory_order_relaxed)) {
+            table.insert(lnk, object);
+            table.erase(lnk);
+            lnk++;
+        }
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> dispatchers;
+    for (int t = 0; t < threads; t++) {
+        dispatchers.push_back(std::thread([&, t] {
+            uint64_t seed = 0x9e3779b97f4a7c15ULL * (t + 1);
+            uint64_t hits = 0;
+            std::shared_ptr<int> value;
+            for (int i = 0; i < lookups; i++) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                if (table.search((HLNK) (seed % (uint64_t) links), value)) {
+                    hits++;
+                }
+            }
+            found += hits;
+        }));
+    }
+    for (std::thread &th : dispatchers) {
+        th.join();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    stop = 1;
+    churn.join();
+
+    double total = (double) threads * lookups;
+    printf("%-12s threads=%-3d %8.1f ns/lookup(per thread) %10.2f Mlookups/s hits=%llu\n", name, threads,
+            (double) elapsed * threads / total, total * 1000.0 / (double) elapsed, (unsigned long long) found.load());
+}
+
+int main(int argc, char **argv) {
+    int links = ((argc > 1) ? atoi(argv[1]) : 20000);
+    int lookups = ((argc > 2) ? atoi(argv[2]) : 2000000);
+
+    for (int threads : {1, 4, 16}) {
+        {
+            map_table table;
+            run("mutex+map", table, links, threads, lookups);
+        }
+        {
+            link_table<std::shared_ptr<int>> table;
+            run("link_table", table, links, threads, lookups);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+﻿/*
+ *  encode/decode cost of the two serialization engines on the same messages:
+ *  @proto_interface(one virtual call per field, vtable pointer stored in every field) against
+ *  @STATIC_PROTO_FIELDS(resolved at compile time and inlined), both produce the same bytes
+ *
+ *  build:  g++ -std=c++11 -O2 -DSTD_CALL= -I.. static_serialize_bench.cpp -o static_serialize_bench
+ *  usage:  ./static_serialize_bench [rounds]
+ *
+ *  "small" is a request head: a few integers and a short string.
+ *  "large" is a report: 64 nested items, each with integers, a string and a vector of 8 floats.
+ *  encode is @length plus @serialize into a reused buffer, decode is @build into a new message each time
+ *  (@proto_vector_t appends to the elements it already holds), so decode includes the allocations of the message.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "static_serialize.hpp"
+
+using namespace nsp::proto;
+
+///////////////////////////////////////		proto_interface messages ///////////////////////////////////////
+struct virtual_small : public proto_interface {
+    proto_crt_t<uint32_t> id_;
+    proto_crt_t<uint16_t> type_;
+    proto_crt_t<uint64_t> session_;
+    proto_string_t<char> name_;
+
+    virtual const int length() const override {
+        return id_.length() + type_.length() + session_.length() + name_.length();
+    }
+
+    virtual unsigned char *serialize(unsigned char *bytes) const override {
+        unsigned char *pos = id_.serialize(bytes);
+        pos = type_.serialize(pos);
+        pos = session_.serialize(pos);
+        return name_.serialize(pos);
+    }
+
+    virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+        const unsigned char *pos = id_.build(bytes, cb);
+        if (pos) pos = type_.build(pos, cb);
+        if (pos) pos = session_.build(pos, cb);
+        if (pos) pos = name_.build(pos, cb);
+        return pos;
+    }
+};
+
+struct virtual_item : public proto_interface {
+    proto_crt_t<uint32_t> index_;
+    proto_crt_t<double> value_;
+    proto_string_t<char> label_;
+    proto_vector_t<proto_crt_t<float>> samples_;
+
+    virtual const int length() const override {
+        return index_.length() + value_.length() + label_.length() + samples_.length();
+    }
+
+    virtual unsigned char *serialize(unsigned char *bytes) const override {
+        unsigned char *pos = index_.serialize(bytes);
+        pos = value_.serialize(pos);
+        pos = label_.serialize(pos);
+        return samples_.serialize(pos);
+    }
+
+    virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+        const unsigned char *pos = index_.build(bytes, cb);
+        if (pos) pos = value_.build(pos, cb);
+        if (pos) pos = label_.build(pos, cb);
+        if (pos) pos = samples_.build(pos, cb);
+        return pos;
+    }
+};
+
+struct virtual_large : public proto_interface {
+    proto_crt_t<uint32_t> id_;
+    proto_string_t<char> source_;
+    proto_vector_t<virtual_item> items_;
+
+    virtual const int length() const override {
+        return id_.length() + source_.length() + items_.length();
+    }
+
+    virtual unsigned char *serialize(unsigned char *bytes) const override {
+        unsigned char *pos = id_.serialize(bytes);
+        pos = source_.serialize(pos);
+        return items_.serialize(pos);
+    }
+
+    virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+        const unsigned char *pos = id_.build(bytes, cb);
+        if (pos) pos = source_.build(pos, cb);
+        if (pos) pos = items_.build(pos, cb);
+        return pos;
+    }
+};
+
+///////////////////////////////////////		static messages ///////////////////////////////////////
+struct static_small {
+    uint32_t id_;
+    uint16_t type_;
+    uint64_t session_;
+    std::string name_;
+    STATIC_PROTO_FIELDS(id_, type_, session_, name_)
+};
+
+struct static_item {
+    uint32_t index_;
+    double value_;
+    std::string label_;
+    std::vector<float> samples_;
+    STATIC_PROTO_FIELDS(index_, value_, label_, samples_)
+};
+
+struct static_large {
+    uint32_t id_;
+    std::string source_;
+    std::vector<static_item> items_;
+    STATIC_PROTO_FIELDS(id_, source_, items_)
+};
+
+static void fill(virtual_small &v, static_small &s) {
+    v.id_ = s.id_ = 1001;
+    v.type_ = s.type_ = 7;
+    v.session_ = s.session_ = 0x1122334455667788ULL;
+    v.name_ = s.name_ = "login.request";
+}
+
+static void fill(virtual_large &v, static_large &s) {
+    v.id_ = s.id_ = 2002;
+    v.source_ = s.source_ = "sensor-array-07";
+    for (int i = 0; i < 64; i++) {
+        virtual_item vi;
+        static_item si;
+        vi.index_ = si.index_ = i;
+        vi.value_ = si.value_ = i * 0.5;
+        vi.label_ = si.label_ = "channel-" + std::to_string(i);
+        for (int j = 0; j < 8; j++) {
+            vi.samples_.push_back(proto_crt_t<float>((float) (i + j)));
+            si.samples_.push_back((float) (i + j));
+        }
+        v.items_.push_back(vi);
+        s.items_.push_back(si);
+    }
+}
+
+static double ns_per(const std::chrono::steady_clock::time_point &begin, const std::chrono::steady_clock::time_point &end, const int rounds) {
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / rounds;
+}
+
+// the message is reached through a pointer like @psend does, so the outer call can not be devirtualized
+static proto_interface *volatile opaque = nullptr;
+
+template<class V, class S>
+static int run(const char *name, const int rounds, const bool report = true) {
+    V vmsg;
+    S smsg;
+    fill(vmsg, smsg);
+
+    std::vector<unsigned char> vbytes(vmsg.length());
+    std::vector<unsigned char> sbytes(static_length(smsg));
+    vmsg.serialize(vbytes.data());
+    static_serialize(smsg, sbytes.data());
+    if (vbytes != sbytes) {
+        printf("%s: the wire format of two engines differ\n", name);
+        return -1;
+    }
+
+    std::vector<unsigned char> buffer(vbytes.size());
+    uint64_t sink = 0;
+
+    opaque = &vmsg;
+    const proto_interface *package = opaque;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        buffer.resize(package->length());
+        package->serialize(buffer.data());
+        sink += buffer[i % buffer.size()];
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        buffer.resize(static_length(smsg));
+        static_serialize(smsg, buffer.data());
+        sink += buffer[i % buffer.size()];
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < rounds; i++) {
+        V vout;
+        opaque = &vout;
+        int cb = (int) vbytes.size();
+        if (opaque->build(vbytes.data(), cb)) sink += cb;
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        S sout;
+        int cb = (int) sbytes.size();
+        if (static_build(sout, sbytes.data(), cb)) sink += cb;
+    }
+    auto t4 = std::chrono::steady_clock::now();
+
+    if (!report) {
+        return (int) (sink & 1);
+    }
+    printf("%-6s %6d bytes  encode  proto_interface %8.1f ns  static %8.1f ns\n", name, (int) vbytes.size(), ns_per(t0, t1, rounds), ns_per(t1, t2, rounds));
+    printf("%-6s %6s        decode  proto_interface %8.1f ns  static %8.1f ns\n", "", "", ns_per(t2, t3, rounds), ns_per(t3, t4, rounds));
+    return (int) (sink & 1);
+}
+
+int main(int argc, char **argv) {
+    int rounds = ((argc > 1) ? atoi(argv[1]) : 200000);
+
+    // first round warms caches up
+    run<virtual_small, static_small>("small", rounds / 10, false);
+    run<virtual_large, static_large>("large", rounds / 100, false);
+
+    run<virtual_small, static_small>("small", rounds);
+    run<virtual_large, static_large>("large", rounds / 10);
+    return 0;
+}
@@ -0,0 +1,112 @@
+﻿#include <cstring>
+#include <cstdint>
+
+#include "toolkit.h"
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define BYTE_ORDER_SIMD     (1)
+#include <immintrin.h>
+#endif
+
+namespace nsp {
+    namespace toolkit {
+
+        typedef void (*byte_order_routine)(unsigned char *dst, const unsigned char *src, std::size_t count, std::size_t width);
+
+        template<class T>
+        static void change_byte_order_scalar(unsigned char *dst, const unsigned char *src, std::size_t count) {
+            for (std::size_t i = 0; i < count; i++) {
+                T v;
+                memcpy(&v, src + i * sizeof ( T), sizeof ( T));
+                v = byte_order_swapper<sizeof ( T)>::swap(v);
+                memcpy(dst + i * sizeof ( T), &v, sizeof ( T));
+            }
+        }
+
+        static void change_byte_order_scalar(unsigned char *dst, const unsigned char *src, std::size_t count, std::size_t width) {
+            switch (width) {
+                case 2:
+                    change_byte_order_scalar<uint16_t>(dst, src, count);
+                    break;
+                case 4:
+                    change_byte_order_scalar<uint32_t>(dst, src, count);
+                    break;
+                case 8:
+                    change_byte_order_scalar<uint64_t>(dst, src, count);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+#if BYTE_ORDER_SIMD
+        // 每 16 字节的重排掩码, 分别对应宽度 2/4/8
+        static const unsigned char byte_order_masks[3][16] = {
+            { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+            { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+            { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8},
+        };
+
+        static const unsigned char *byte_order_mask(std::size_t width) {
+            return byte_order_masks[(2 == width) ? 0 : ((4 == width) ? 1 : 2)];
+        }
+
+        __attribute__((target("ssse3")))
+        static void change_byte_order_ssse3(unsigned char *dst, const unsigned char *src, std::size_t count, std::size_t width) {
+            std::size_t bytes = count * width;
+            std::size_t offset = 0;
+            __m128i mask = _mm_loadu_si128((const __m128i *) byte_order_mask(width));
+            for (; offset + 16 <= bytes; offset += 16) {
+                __m128i v = _mm_loadu_si128((const __m128i *) (src + offset));
+                _mm_storeu_si128((__m128i *) (dst + offset), _mm_shuffle_epi8(v, mask));
+            }
+            change_byte_order_scalar(dst + offset, src + offset, (bytes - offset) / width, width);
+        }
+
+        // _mm256_shuffle_epi8 在两个 128 位通道内分别重排, 元素不会跨越通道, 因此掩码重复两次即可
+        __attribute__((target("avx2")))
+        static void change_byte_order_avx2(unsigned char *dst, const unsigned char *src, std::size_t count, std::size_t width) {
+            std::size_t bytes = count * width;
+            std::size_t offset = 0;
+            __m128i half = _mm_loadu_si128((const __m128i *) byte_order_mask(width));
+            __m256i mask = _mm256_broadcastsi128_si256(half);
+            for (; offset + 32 <= bytes; offset += 32) {
+                __m256i v = _mm256_loadu_si256((const __m256i *) (src + offset));
+                _mm256_storeu_si256((__m256i *) (dst + offset), _mm256_shuffle_epi8(v, mask));
+            }
+            change_byte_order_scalar(dst + offset, src + offset, (bytes - offset) / width, width);
+        }
+#endif
+
+        static byte_order_routine select_byte_order_routine() {
+#if BYTE_ORDER_SIMD
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return &change_byte_order_avx2;
+            }
+            if (__builtin_cpu_supports("ssse3")) {
+                return &change_byte_order_ssse3;
+            }
+#endif
+            return &change_byte_order_scalar;
+        }
+
+        void change_byte_order(void *dst, const void *src, std::size_t count, std::size_t width) {
+            static const byte_order_routine routine = select_byte_order_routine();
+
+            if (!dst || !src || 0 == count) {
+                return;
+            }
+
+            // other widths(long double) are copied unchanged, the same as @proto_element_order does for a single value
+            if (2 != width && 4 != width && 8 != width) {
+                if (dst != src) {
+                    memmove(dst, src, count * width);
+                }
+                return;
+            }
+            routine((unsigned char *) dst, (const unsigned char *) src, count, width);
+        }
+
+    } // namespace toolkit
+} // namespace nsp
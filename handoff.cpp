@@ -0,0 +1,187 @@
+﻿#include <cstring>
+
+#if !_WIN32
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+#include "handoff.h"
+#include "os_util.hpp"
+
+#include "icom/posix_thread.h"
+
+namespace nsp {
+    namespace tcpip {
+
+        handoff_task::handoff_task(const std::shared_ptr<obtcp> &object, const packet_ptr &pkt) : object_(object), pkt_(pkt) {
+            ;
+        }
+
+        handoff_task::handoff_task(const std::shared_ptr<obtcp> &object, const HTCPLINK previous) : object_(object), previous_(previous) {
+            ;
+        }
+
+        handoff_task::handoff_task(const std::shared_ptr<obtcp> &object, const std::function<void()> &routine) : object_(object), routine_(routine) {
+            ;
+        }
+
+        void handoff_task::on_task() {
+            if (!object_) {
+                return;
+            }
+
+            if (routine_) {
+                routine_();
+            } else if (pkt_) {
+                object_->deliver(pkt_.data(), pkt_.size());
+            } else {
+                object_->on_closed(previous_);
+            }
+        }
+
+        ///////////////////////////////////////		handoff ///////////////////////////////////////
+        std::atomic<int> handoff::workers_count_{0};
+        std::atomic<int> handoff::constructed_{0};
+        std::atomic<int> handoff::affinity_{0};
+
+        // the cores allowed to the constructing thread(which the workers would inherit), the workers are spread over them in order
+        static void allowed_cores(std::vector<int> &cores) {
+            cores.clear();
+#if !_WIN32
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            if (0 == ::sched_getaffinity(0, sizeof (cpus), &cpus)) {
+                for (int i = 0; i < CPU_SETSIZE; i++) {
+                    if (CPU_ISSET(i, &cpus)) {
+                        cores.push_back(i);
+                    }
+                }
+            }
+#endif
+            if (cores.empty()) {
+                int nprocs = os::getnprocs();
+                // the affinity mask of posix__pthread_setaffinity is 32 bits
+                for (int i = 0; i < nprocs && i < 32; i++) {
+                    cores.push_back(i);
+                }
+            }
+        }
+
+        static void pin(toolkit::task_thread<handoff_task> *worker, const int core) {
+#if !_WIN32
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(core, &cpus);
+            ::pthread_setaffinity_np(worker->native_handle(), sizeof (cpus), &cpus);
+#else
+            posix__pthread_t tid;
+            memset(&tid, 0, sizeof (tid));
+            tid.pid_ = (decltype(tid.pid_)) worker->native_handle();
+            posix__pthread_setaffinity(&tid, (int) (1U << core));
+#endif
+        }
+
+        handoff::handoff() {
+            int workers = workers_count_.load();
+            if (workers <= 0) {
+                workers = os::getnprocs();
+            }
+            if (workers <= 0) {
+                workers = 1;
+            }
+
+            std::vector<int> cores;
+            if (affinity_ > 0) {
+                allowed_cores(cores);
+            }
+
+            constructed_ = 1;
+            for (int i = 0; i < workers; i++) {
+                toolkit::task_thread<handoff_task> *worker = new toolkit::task_thread<handoff_task>;
+                if (!cores.empty()) {
+                    pin(worker, cores[(std::size_t) i % cores.size()]);
+                }
+                workers_.push_back(worker);
+            }
+        }
+
+        handoff::~handoff() {
+            for (auto worker : workers_) {
+                delete worker;
+            }
+        }
+
+        int handoff::setworkers(int workers) {
+            if (constructed_ > 0) {
+                return -1;
+            }
+            workers_count_ = workers;
+            return 0;
+        }
+
+        int handoff::setaffinity(int enable) {
+            if (constructed_ > 0) {
+                return -1;
+            }
+            affinity_ = ((enable > 0) ? 1 : 0);
+            return 0;
+        }
+
+        int handoff::assign() {
+            return (int) (next_worker_++ % workers_.size());
+        }
+
+        toolkit::task_thread<handoff_task> &handoff::worker_of(const int worker) {
+            return *workers_[(std::size_t) worker % workers_.size()];
+        }
+
+        int handoff::post(const int worker, const std::shared_ptr<handoff_task> &task) {
+            if (worker < 0) {
+                return -1;
+            }
+            worker_of(worker).post(task);
+            return 0;
+        }
+
+        int handoff::post(const std::shared_ptr<obtcp> &object, const int worker, const unsigned char *data, const int cb) {
+            packet_ptr pkt = packet_pool::retain(data, cb);
+            if (!pkt) {
+                return -1;
+            }
+
+            try {
+                return post(worker, std::make_shared<handoff_task>(object, pkt));
+            } catch (...) {
+                return -1;
+            }
+        }
+
+        int handoff::post_closed(const std::shared_ptr<obtcp> &object, const int worker, const HTCPLINK previous) {
+            try {
+                return post(worker, std::make_shared<handoff_task>(object, previous));
+            } catch (...) {
+                return -1;
+            }
+        }
+
+        int handoff::post_routine(const std::shared_ptr<obtcp> &object, const int worker, const std::function<void()> &routine) {
+            if (!routine) {
+                return -1;
+            }
+
+            try {
+                return post(worker, std::make_shared<handoff_task>(object, routine));
+            } catch (...) {
+                return -1;
+            }
+        }
+
+        void handoff::depth(std::vector<std::size_t> &depth) {
+            depth.clear();
+            for (auto worker : workers_) {
+                depth.push_back(worker->size());
+            }
+        }
+
+    } // namespace tcpip
+} // namespace nsp
@@ -0,0 +1,78 @@
+﻿#if !defined SWNET_HANDOFF_HEADER
+#define SWNET_HANDOFF_HEADER
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+#include "singleton.hpp"
+#include "task_scheduler.hpp"
+#include "network_handler.h"
+#include "packet_pool.h"
+
+/*
+ *  hand-off dispatch, move the receive callbacks of a link from nshost I/O thread to a worker thread
+ *
+ *  every link enabled hand-off is assigned to one worker(round robin), the received bytes are retained into a pooled @packet_ptr
+ *  and posted to that worker, so all packets, routines, timer expiries(@link_timer) and the final close notification of one link
+ *  are handled in order by the same thread, while the I/O thread return to nshost immediately.
+ *  with @setaffinity, worker N is pinned to the (N % count)th core allowed to the process, so the state of a session stays
+ *  in the cache of one core.
+ */
+
+namespace nsp {
+    namespace tcpip {
+
+        class handoff_task {
+        public:
+            handoff_task(const std::shared_ptr<obtcp> &object, const packet_ptr &pkt);
+            handoff_task(const std::shared_ptr<obtcp> &object, const HTCPLINK previous);
+            handoff_task(const std::shared_ptr<obtcp> &object, const std::function<void()> &routine);
+
+            void on_task();
+
+        private:
+            std::shared_ptr<obtcp> object_;
+            packet_ptr pkt_;
+            HTCPLINK previous_ = INVALID_HTCPLINK;
+            std::function<void()> routine_;
+        };
+
+        class handoff {
+            std::vector<toolkit::task_thread<handoff_task> *> workers_;
+
+            std::atomic<unsigned int> next_worker_{0};
+
+            toolkit::task_thread<handoff_task> &worker_of(const int worker);
+            int post(const int worker, const std::shared_ptr<handoff_task> &task);
+
+            friend class nsp::toolkit::singleton<handoff>;
+            handoff();
+            ~handoff();
+
+            static std::atomic<int> workers_count_;
+            static std::atomic<int> constructed_;
+            static std::atomic<int> affinity_;
+
+        public:
+            // the count of worker threads, must be set before the first link enable hand-off,
+            // zero or negative means the count of processors. return -1 if the workers have already been started
+            static int setworkers(int workers);
+            // pin each worker to one of the CPU cores allowed by the affinity of the process, same restriction as @setworkers
+            static int setaffinity(int enable);
+
+            // select the worker of a new link
+            int assign();
+            int post(const std::shared_ptr<obtcp> &object, const int worker, const unsigned char *data, const int cb);
+            int post_closed(const std::shared_ptr<obtcp> &object, const int worker, const HTCPLINK previous);
+            int post_routine(const std::shared_ptr<obtcp> &object, const int worker, const std::function<void()> &routine);
+            // pending tasks of each worker
+            void depth(std::vector<std::size_t> &depth);
+        };
+
+    } // namespace tcpip
+} // namespace nsp
+
+#endif // !SWNET_HANDOFF_HEADER
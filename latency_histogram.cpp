@@ -0,0 +1,86 @@
+﻿#include "latency_histogram.h"
+
+namespace nsp {
+    namespace tcpip {
+
+        latency_histogram::latency_histogram() {
+            for (auto &count : counts_) {
+                count.store(0, std::memory_order_relaxed);
+            }
+            max_.store(0, std::memory_order_relaxed);
+        }
+
+        int latency_histogram::bucket_of(const uint64_t value) {
+            if (value < (uint64_t) kSubBuckets) {
+                return (int) value;
+            }
+
+            int msb = 63 - __builtin_clzll(value);
+            int shift = msb - kSubBits;
+            if (shift > kMaximumShift) {
+                return kBuckets - 1;
+            }
+            return (shift + 1) * kSubBuckets + (int) ((value >> shift) & (kSubBuckets - 1));
+        }
+
+        uint64_t latency_histogram::upper_of(const int bucket) {
+            if (bucket < kSubBuckets) {
+                return (uint64_t) bucket;
+            }
+
+            int shift = bucket / kSubBuckets - 1;
+            uint64_t lower = (uint64_t) (kSubBuckets + bucket % kSubBuckets) << shift;
+            return lower + ((uint64_t) 1 << shift) - 1;
+        }
+
+        // single writer, plain load and store are enough for concurrent readers
+        void latency_histogram::record(const uint64_t value) {
+            std::atomic<uint64_t> &count = counts_[bucket_of(value)];
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (value > max_.load(std::memory_order_relaxed)) {
+                max_.store(value, std::memory_order_relaxed);
+            }
+        }
+
+        void latency_histogram::merge(std::vector<uint64_t> &counts, uint64_t &max) const {
+            counts.resize(kBuckets, 0);
+            for (int i = 0; i < kBuckets; i++) {
+                counts[i] += counts_[i].load(std::memory_order_relaxed);
+            }
+            uint64_t value = max_.load(std::memory_order_relaxed);
+            if (value > max) {
+                max = value;
+            }
+        }
+
+        void latency_histogram::percentile(const std::vector<uint64_t> &counts, const uint64_t max, latency_stat &stat) {
+            stat.count_ = 0;
+            for (uint64_t count : counts) {
+                stat.count_ += count;
+            }
+            stat.p50_ = stat.p99_ = stat.p999_ = 0;
+            stat.max_ = max;
+            if (0 == stat.count_) {
+                return;
+            }
+
+            // rank of each percentile, rounded up so that at least the given fraction is covered
+            const uint64_t ranks[3] = {
+                (stat.count_ * 500 + 999) / 1000,
+                (stat.count_ * 990 + 999) / 1000,
+                (stat.count_ * 999 + 999) / 1000
+            };
+            uint64_t *results[3] = {&stat.p50_, &stat.p99_, &stat.p999_};
+            int next = 0;
+            uint64_t accumulated = 0;
+            for (int i = 0; i < (int) counts.size() && next < 3; i++) {
+                accumulated += counts[i];
+                while (next < 3 && accumulated >= ranks[next]) {
+                    uint64_t upper = upper_of(i);
+                    *results[next++] = ((upper < max) ? upper : max);
+                }
+            }
+        }
+
+    } // namespace tcpip
+} // namespace nsp
@@ -0,0 +1,54 @@
+﻿#if !defined SWNET_LATENCY_HISTOGRAM_HEADER
+#define SWNET_LATENCY_HISTOGRAM_HEADER
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+/*
+ *  log-linear latency histogram
+ *
+ *  values below @kSubBuckets have their own bucket, every larger power of two range is split into @kSubBuckets
+ *  linear buckets, so the relative error of any reported value is less than 1/@kSubBuckets.
+ *  @record is designed for a single writer thread(no locked instruction), any thread can read by @merge at any time,
+ *  so keep one histogram per writer thread and merge them on read.
+ */
+
+namespace nsp {
+    namespace tcpip {
+
+        // percentiles reported by upper bound of the bucket, in the unit of recorded values
+        struct latency_stat {
+            uint64_t count_;
+            uint64_t p50_;
+            uint64_t p99_;
+            uint64_t p999_;
+            uint64_t max_;
+        };
+
+        class latency_histogram {
+        public:
+            static const int kSubBits = 4;
+            static const int kSubBuckets = (1 << kSubBits);
+            static const int kMaximumShift = 35; // values larger than (2^40) fall into the last bucket
+            static const int kBuckets = (kMaximumShift + 2) * kSubBuckets;
+
+            latency_histogram();
+
+            void record(const uint64_t value);
+            // accumulate this histogram into @counts(resized to @kBuckets) and @max
+            void merge(std::vector<uint64_t> &counts, uint64_t &max) const;
+
+            static int bucket_of(const uint64_t value);
+            static uint64_t upper_of(const int bucket);
+            static void percentile(const std::vector<uint64_t> &counts, const uint64_t max, latency_stat &stat);
+
+        private:
+            std::atomic<uint64_t> counts_[kBuckets];
+            std::atomic<uint64_t> max_;
+        };
+
+    } // namespace tcpip
+} // namespace nsp
+
+#endif // !SWNET_LATENCY_HISTOGRAM_HEADER
@@ -0,0 +1,352 @@
+﻿#if !defined SWNET_LINK_TABLE_HEADER
+#define SWNET_LINK_TABLE_HEADER
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+#include "icom/nisdef.h"
+
+/*
+ *  read-mostly mapping from link handle to object, used by the I/O dispatch of @swnet
+ *
+ *  the table split into power-of-two shards selected by (lnk & (shards - 1)), each shard has it's own buckets,
+ *  reader counters and a non-recursive writer lock, so attach/detach on one shard never disturb the others.
+ *  readers (nshost I/O threads looking up the object of a event) never block and never take a lock,
+ *  only the writers (attach/detach) of the same shard are serialized by @writer_lock_.
+ *
+ *  reclaim of removed nodes use a two-phase grace period:
+ *  writer unlink the node, flip the phase and then wait all readers which entered in the previous phase leave,
+ *  after that, nobody can hold the node pointer any more and it can be deleted.
+ *  reader counters are spread over @kReaderSlots cache lines and select by calling thread, so that readers
+ *  on different threads do not bounce the same cache line.
+ *
+ *  NOTE: never call any writer method of the same table inside @for_each, the grace period will wait itself forever.
+ */
+
+namespace nsp {
+    namespace tcpip {
+
+        // runtime statistic of one shard, @contended_ is the count of writer lock acquisitions which had to wait
+        struct link_shard_stat {
+            std::size_t size_;
+            uint64_t acquired_;
+            uint64_t contended_;
+        };
+
+        template<class V>
+        class link_table {
+            static const int kReaderSlots = 32;
+            static const std::size_t kInitialBuckets = 64;
+
+        public:
+            static const int kDefaultShards = 16;
+            static const int kMaximumShards = 1024;
+
+        private:
+
+            struct node {
+                node(const HLNK lnk, const V &value) : lnk_(lnk), value_(value), next_(nullptr) {
+                }
+
+                const HLNK lnk_;
+                V value_;
+                std::atomic<node *> next_;
+            };
+
+            struct bucket_array {
+                bucket_array(std::size_t n) : mask_(n - 1), heads_(n) {
+                    for (auto &head : heads_) head.store(nullptr, std::memory_order_relaxed);
+                }
+
+                const std::size_t mask_;
+                std::vector<std::atomic<node *>> heads_;
+            };
+
+            struct reader_slot {
+                std::atomic<long> active_[2];
+                char padding_[64 - 2 * sizeof (std::atomic<long>)];
+            };
+
+            struct shard {
+                shard() : buckets_(new bucket_array(kInitialBuckets)) {
+                    for (auto &slot : readers_) {
+                        slot.active_[0].store(0, std::memory_order_relaxed);
+                        slot.active_[1].store(0, std::memory_order_relaxed);
+                    }
+                }
+
+                ~shard() {
+                    bucket_array *ba = buckets_.load();
+                    for (auto &head : ba->heads_) {
+                        node *n = head.load(std::memory_order_relaxed);
+                        while (n) {
+                            node *next = n->next_.load(std::memory_order_relaxed);
+                            delete n;
+                            n = next;
+                        }
+                    }
+                    delete ba;
+                }
+
+                std::atomic<bucket_array *> buckets_;
+                std::atomic<unsigned int> phase_{0};
+                reader_slot readers_[kReaderSlots];
+                std::mutex writer_lock_;
+                std::size_t count_ = 0;
+                std::atomic<uint64_t> acquired_{0};
+                std::atomic<uint64_t> contended_{0};
+            };
+
+            // count the contention when acquire the writer lock of a shard
+            class writer_guard {
+                shard &shard_;
+            public:
+                writer_guard(shard &s) : shard_(s) {
+                    if (!shard_.writer_lock_.try_lock()) {
+                        shard_.contended_.fetch_add(1, std::memory_order_relaxed);
+                        shard_.writer_lock_.lock();
+                    }
+                    shard_.acquired_.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                ~writer_guard() {
+                    shard_.writer_lock_.unlock();
+                }
+
+                writer_guard(const writer_guard &) = delete;
+                writer_guard &operator=(const writer_guard &) = delete;
+            };
+
+            std::vector<shard *> shards_;
+            const std::size_t shard_mask_;
+
+            static std::size_t hash(const HLNK lnk) {
+                uint64_t h = (uint64_t) lnk;
+                h ^= h >> 33;
+                h *= 0xff51afd7ed558ccdULL;
+                h ^= h >> 33;
+                return (std::size_t) h;
+            }
+
+            static int shards_of(int shards) {
+                if (shards <= 0) {
+                    return kDefaultShards;
+                }
+                if (shards > kMaximumShards) {
+                    return kMaximumShards;
+                }
+                int n = 1;
+                while (n < shards) n <<= 1;
+                return n;
+            }
+
+            static reader_slot &slot_of(shard &s) {
+                static std::atomic<unsigned int> next_slot{0};
+                static thread_local unsigned int index = next_slot++ % kReaderSlots;
+                return s.readers_[index];
+            }
+
+            shard &shard_of(const HLNK lnk) const {
+                return *shards_[(std::size_t) lnk & shard_mask_];
+            }
+
+            // stay in the read side of a shard during the lifetime of the guard,
+            // leave it even if the visitor throws, otherwise the writers of this shard wait forever in @synchronize
+            class read_guard {
+                reader_slot &slot_;
+                unsigned int phase_;
+            public:
+                read_guard(shard &s) : slot_(slot_of(s)) {
+                    for (;;) {
+                        phase_ = s.phase_.load() & 1;
+                        slot_.active_[phase_].fetch_add(1);
+                        if ((s.phase_.load() & 1) == phase_) {
+                            break;
+                        }
+                        slot_.active_[phase_].fetch_sub(1, std::memory_order_release);
+                    }
+                }
+
+                ~read_guard() {
+                    slot_.active_[phase_].fetch_sub(1, std::memory_order_release);
+                }
+
+                read_guard(const read_guard &) = delete;
+                read_guard &operator=(const read_guard &) = delete;
+            };
+
+            // must be called with @writer_lock_ of the shard held, wait all readers of current phase leave
+            static void synchronize(shard &s) {
+                unsigned int previous = s.phase_.fetch_add(1) & 1;
+                for (int i = 0; i < kReaderSlots; i++) {
+                    while (0 != s.readers_[i].active_[previous].load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            static node *find(const bucket_array *ba, const HLNK lnk) {
+                node *n = ba->heads_[hash(lnk) & ba->mask_].load(std::memory_order_acquire);
+                while (n && n->lnk_ != lnk) {
+                    n = n->next_.load(std::memory_order_acquire);
+                }
+                return n;
+            }
+
+            // double the bucket array, the nodes are copied because their chain links are visible to readers
+            static void grow(shard &s, std::vector<node *> &retired, bucket_array *&retired_array) {
+                bucket_array *previous = s.buckets_.load(std::memory_order_relaxed);
+                bucket_array *ba = new bucket_array(previous->heads_.size() << 1);
+                for (auto &head : previous->heads_) {
+                    for (node *n = head.load(std::memory_order_relaxed); n; n = n->next_.load(std::memory_order_relaxed)) {
+                        node *copied = new node(n->lnk_, n->value_);
+                        std::atomic<node *> &slot = ba->heads_[hash(n->lnk_) & ba->mask_];
+                        copied->next_.store(slot.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                        slot.store(copied, std::memory_order_relaxed);
+                        retired.push_back(n);
+                    }
+                }
+                s.buckets_.store(ba, std::memory_order_release);
+                retired_array = previous;
+            }
+
+        public:
+            // @shards round up to power of two
+            link_table(int shards = kDefaultShards) : shard_mask_(shards_of(shards) - 1) {
+                for (std::size_t i = 0; i <= shard_mask_; i++) {
+                    shards_.push_back(new shard);
+                }
+            }
+
+            ~link_table() {
+                for (shard *s : shards_) {
+                    delete s;
+                }
+            }
+
+            link_table(const link_table &) = delete;
+            link_table &operator=(const link_table &) = delete;
+
+            // lock free lookup, copy the value out when found
+            bool search(const HLNK lnk, V &value) const {
+                shard &s = shard_of(lnk);
+                read_guard guard(s);
+                node *n = find(s.buckets_.load(std::memory_order_acquire), lnk);
+                if (n) {
+                    value = n->value_;
+                }
+                return (nullptr != n);
+            }
+
+            // visit every element inside the read side, @todo must be short and must not modify this table.
+            // an exception thrown by @todo leaves the read side and propagates to the caller
+            template<class F>
+            void for_each(F &&todo) const {
+                for (shard *s : shards_) {
+                    read_guard guard(*s);
+                    const bucket_array *ba = s->buckets_.load(std::memory_order_acquire);
+                    for (auto &head : ba->heads_) {
+                        for (node *n = head.load(std::memory_order_acquire); n; n = n->next_.load(std::memory_order_acquire)) {
+                            todo(n->lnk_, n->value_);
+                        }
+                    }
+                }
+            }
+
+            // insert a new element, fails if @lnk already existed
+            bool insert(const HLNK lnk, const V &value) {
+                std::vector<node *> retired;
+                bucket_array *retired_array = nullptr;
+                shard &s = shard_of(lnk);
+                {
+                    writer_guard guard(s);
+                    bucket_array *ba = s.buckets_.load(std::memory_order_relaxed);
+                    if (find(ba, lnk)) {
+                        return false;
+                    }
+
+                    if (s.count_ + 1 > (ba->heads_.size() << 1)) {
+                        grow(s, retired, retired_array);
+                        ba = s.buckets_.load(std::memory_order_relaxed);
+                    }
+
+                    node *n = new node(lnk, value);
+                    std::atomic<node *> &head = ba->heads_[hash(lnk) & ba->mask_];
+                    n->next_.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    head.store(n, std::memory_order_release);
+                    ++s.count_;
+
+                    if (retired_array) {
+                        synchronize(s);
+                    }
+                }
+
+                // release out of the writer lock, destructor of the value may come back to this table
+                for (node *n : retired) delete n;
+                delete retired_array;
+                return true;
+            }
+
+            // remove the element, return false if @lnk not existed
+            bool erase(const HLNK lnk) {
+                node *removed = nullptr;
+                shard &s = shard_of(lnk);
+                {
+                    writer_guard guard(s);
+                    bucket_array *ba = s.buckets_.load(std::memory_order_relaxed);
+                    std::atomic<node *> *link = &ba->heads_[hash(lnk) & ba->mask_];
+                    node *n = link->load(std::memory_order_relaxed);
+                    while (n && n->lnk_ != lnk) {
+                        link = &n->next_;
+                        n = link->load(std::memory_order_relaxed);
+                    }
+                    if (!n) {
+                        return false;
+                    }
+
+                    link->store(n->next_.load(std::memory_order_relaxed), std::memory_order_release);
+                    --s.count_;
+                    synchronize(s);
+                    removed = n;
+                }
+
+                delete removed;
+                return true;
+            }
+
+            std::size_t size() const {
+                std::size_t sum = 0;
+                for (shard *s : shards_) {
+                    std::lock_guard < decltype(s->writer_lock_) > guard(s->writer_lock_);
+                    sum += s->count_;
+                }
+                return sum;
+            }
+
+            int shards() const {
+                return (int) (shard_mask_ + 1);
+            }
+
+            // read the statistic of every shard, the counters are sampled without any lock
+            void stat(std::vector<link_shard_stat> &shard_stat) const {
+                shard_stat.clear();
+                for (shard *s : shards_) {
+                    link_shard_stat st;
+                    {
+                        std::lock_guard < decltype(s->writer_lock_) > guard(s->writer_lock_);
+                        st.size_ = s->count_;
+                    }
+                    st.acquired_ = s->acquired_.load(std::memory_order_relaxed);
+                    st.contended_ = s->contended_.load(std::memory_order_relaxed);
+                    shard_stat.push_back(st);
+                }
+            }
+        };
+
+    } // namespace tcpip
+} // namespace nsp
+
+#endif // !SWNET_LINK_TABLE_HEADER
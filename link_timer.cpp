@@ -0,0 +1,70 @@
+﻿#include "link_timer.h"
+
+namespace nsp {
+    namespace tcpip {
+
+        link_timer::link_timer() : th_(std::bind(&link_timer::th_handler, this)) {
+            ;
+        }
+
+        link_timer::~link_timer() {
+            {
+                std::lock_guard < decltype(locker_) > guard(locker_);
+                join_ = 1;
+                cv_.notify_one();
+            }
+            if (th_.joinable()) {
+                th_.join();
+            }
+        }
+
+        void link_timer::th_handler() {
+            std::unique_lock < decltype(locker_) > guard(locker_);
+            while (0 == join_) {
+                if (timers_.empty()) {
+                    cv_.wait(guard);
+                    continue;
+                }
+
+                auto due = timers_.top().due_;
+                if (std::chrono::steady_clock::now() < due) {
+                    cv_.wait_until(guard, due);
+                    continue;
+                }
+
+                std::function<void()> routine = std::move(const_cast<timer_entry &> (timers_.top()).routine_);
+                timers_.pop();
+
+                // the routine may schedule again
+                guard.unlock();
+                try {
+                    routine();
+                } catch (...) {
+                    ;
+                }
+                guard.lock();
+            }
+        }
+
+        int link_timer::schedule(const uint32_t delay_us, const std::function<void()> &routine) {
+            if (!routine) {
+                return -1;
+            }
+
+            try {
+                timer_entry entry = {std::chrono::steady_clock::now() + std::chrono::microseconds(delay_us), 0, routine};
+                std::lock_guard < decltype(locker_) > guard(locker_);
+                entry.sequence_ = sequence_++;
+                bool earliest = (timers_.empty() || timers_.top() > entry);
+                timers_.push(std::move(entry));
+                if (earliest) {
+                    cv_.notify_one();
+                }
+            } catch (...) {
+                return -1;
+            }
+            return 0;
+        }
+
+    } // namespace tcpip
+} // namespace nsp
@@ -0,0 +1,57 @@
+﻿#if !defined SWNET_LINK_TIMER_HEADER
+#define SWNET_LINK_TIMER_HEADER
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+#include "singleton.hpp"
+
+/*
+ *  one shot timers of the links, nshost has neither timer nor writable event,
+ *  the delayed works of @obtcp(flush of the cork window, re-check of the send watermarks) are timed by this single thread.
+ *  routines are run one by one on the timer thread, so they must be short and never block,
+ *  @obtcp post the expiries of a hand-off link to it's worker, so they run on the core pinned for that link.
+ */
+
+namespace nsp {
+    namespace tcpip {
+
+        class link_timer {
+            struct timer_entry {
+                std::chrono::steady_clock::time_point due_;
+                uint64_t sequence_; // keep the order of routines with the same due time
+                std::function<void()> routine_;
+
+                bool operator>(const timer_entry &rf) const {
+                    return (due_ > rf.due_ || (due_ == rf.due_ && sequence_ > rf.sequence_));
+                }
+            };
+
+            std::priority_queue<timer_entry, std::vector<timer_entry>, std::greater<timer_entry>> timers_;
+            uint64_t sequence_ = 0;
+            int join_ = 0;
+            std::mutex locker_;
+            std::condition_variable cv_;
+            std::thread th_;
+
+            void th_handler();
+
+            friend class nsp::toolkit::singleton<link_timer>;
+            link_timer();
+            ~link_timer();
+
+        public:
+            // run @routine on the timer thread after @delay_us microseconds
+            int schedule(const uint32_t delay_us, const std::function<void()> &routine);
+        };
+
+    } // namespace tcpip
+} // namespace nsp
+
+#endif // !SWNET_LINK_TIMER_HEADER
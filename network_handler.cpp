@@ -5,14 +5,59 @@
 #include <cstdlib>
 #include <cstring>
 #include <map>
+#include <cstddef>
+#include <climits>
+#include <thread>
+
+#if !_WIN32
+#include <netinet/in.h>
+#include <linux/tcp.h>
+#endif
 
 #include "network_handler.h"
 #include "swnet.h"
+#include "handoff.h"
+#include "link_timer.h"
+#include "os_util.hpp"
 
 #include "icom/logger.h"
 
 namespace nsp {
     namespace tcpip {
+        ///////////////////////////////////////		link_counters ///////////////////////////////////////
+        void link_counters::received(const int packets, const int bytes, const uint64_t begin, const uint64_t end) {
+            bytes_in_.fetch_add(bytes, std::memory_order_relaxed);
+            packets_in_.fetch_add(packets, std::memory_order_relaxed);
+            uint64_t elapsed = end - begin;
+            uint64_t longest = max_recv_time_.load(std::memory_order_relaxed);
+            while (elapsed > longest && !max_recv_time_.compare_exchange_weak(longest, elapsed, std::memory_order_relaxed)) {
+                ;
+            }
+            last_activity_.store(end, std::memory_order_relaxed);
+        }
+
+        void link_counters::sent(const int packets, const int bytes, const int retval) {
+            if (retval < 0) {
+                send_failures_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            bytes_out_.fetch_add(bytes, std::memory_order_relaxed);
+            packets_out_.fetch_add(packets, std::memory_order_relaxed);
+            last_activity_.store(os::clock_gettime(), std::memory_order_relaxed);
+        }
+
+        void link_counters::load(link_counter &counter) const {
+            counter.bytes_in_ = bytes_in_.load(std::memory_order_relaxed);
+            counter.packets_in_ = packets_in_.load(std::memory_order_relaxed);
+            counter.bytes_out_ = bytes_out_.load(std::memory_order_relaxed);
+            counter.packets_out_ = packets_out_.load(std::memory_order_relaxed);
+            counter.send_failures_ = send_failures_.load(std::memory_order_relaxed);
+            counter.max_recv_time_ = max_recv_time_.load(std::memory_order_relaxed);
+            uint64_t last = last_activity_.load(std::memory_order_relaxed);
+            uint64_t now = os::clock_gettime();
+            counter.idle_ = ((last > 0 && now > last) ? (now - last) : 0);
+        }
+
         ///////////////////////////////////////		TCP 部分 ///////////////////////////////////////
         static std::atomic_long __tcp_refcnt{ 0}; // GCC4.8中， "= 0"这样的代码被视为废弃
 
@@ -34,8 +79,432 @@ namespace nsp {
 
         void obtcp::settst(tst_t *tst) {
             if (INVALID_HTCPLINK != lnk_ && tst) {
-                ::tcp_settst(lnk_, tst);
+                // in batch mode nshost should not split the stream, the template is used by this object only
+                static const tst_t raw_stream = {nullptr, nullptr, 0};
+                ::tcp_settst(lnk_, (batch_ > 0) ? &raw_stream : tst);
+            }
+        }
+
+        int obtcp::setbatch(int enable) {
+            batch_ = ((enable > 0) ? 1 : 0);
+            settst(&tst_);
+            return 0;
+        }
+
+        // the origin which delivered to @framed_serialize when the framing is done by obtcp
+        struct framed_origin {
+            const tst_t *tst_;
+            const void *origin_;
+            int cb_;
+            nis_serializer_t serializer_;
+        };
+
+        static int frame_head(const tst_t *tst) {
+            return ((tst->builder_ && tst->cb_ > 0) ? tst->cb_ : 0);
+        }
+
+        static int frame(unsigned char *packet, const tst_t *tst, const void *origin, int cb, const nis_serializer_t serializer) {
+            if (frame_head(tst) > 0) {
+                if (tst->builder_(packet, cb) < 0) {
+                    return -1;
+                }
+                packet += tst->cb_;
+            }
+            if (serializer) {
+                return serializer(packet, origin, cb);
             }
+            memcpy(packet, origin, cb);
+            return 0;
+        }
+
+        static int STD_CALL framed_serialize(unsigned char *packet, const void *origin, int cb) {
+            const framed_origin *framed = (const framed_origin *) origin;
+            return frame(packet, framed->tst_, framed->origin_, framed->cb_, framed->serializer_);
+        }
+
+        int obtcp::write(const void *origin, int cb, const nis_serializer_t serializer) {
+            int retval;
+            // once cork mode has been enabled on this link, the choice between cork and submit is made under @cork_lock_,
+            // so that no frame is sent with the framing(LINKATTR_TCP_NO_BUILD) of the other mode, see @gate_writes
+            ++ungated_writes_;
+            if (0 == cork_gated_) {
+                retval = submit(origin, cb, serializer);
+                --ungated_writes_;
+            } else {
+                --ungated_writes_;
+                std::lock_guard < decltype(cork_lock_) > guard(cork_lock_);
+                retval = ((cork_ > 0) ? cork(origin, cb, serializer) : submit(origin, cb, serializer));
+            }
+            counters_.sent(1, cb, retval);
+            if (retval >= 0) {
+                check_watermark(frame_head(&tst_) + cb);
+            }
+            return retval;
+        }
+
+        int obtcp::submit(const void *origin, int cb, const nis_serializer_t serializer) {
+            ++raw_writes_;
+            int wire = frame_head(&tst_) + cb;
+            // counted before the write, so the bytes acknowledged by the peer never exceed it
+            submitted_bytes_.fetch_add(wire, std::memory_order_relaxed);
+            int retval;
+            if (0 == batch_) {
+                retval = ::tcp_write(lnk_, origin, cb, serializer);
+            } else {
+                framed_origin framed = {&tst_, origin, cb, serializer};
+                retval = ::tcp_write(lnk_, &framed, wire, &framed_serialize);
+            }
+            if (retval < 0) {
+                submitted_bytes_.fetch_sub(wire, std::memory_order_relaxed);
+            }
+            return retval;
+        }
+
+        ///////////////////////////////////////		write coalescing ///////////////////////////////////////
+        // merged bytes exceed this limit will be flushed immediately
+        static const std::size_t kMaximumCorkBytes = (64 << 10);
+
+        // the object which receive callback is running on this thread
+        static thread_local const obtcp *dispatching_object = nullptr;
+
+        // route all later writes through @cork_lock_, and wait for the writes which have passed the check without it
+        void obtcp::gate_writes() {
+            cork_gated_ = 1;
+            while (ungated_writes_ > 0) {
+                std::this_thread::yield();
+            }
+        }
+
+        int obtcp::setcork(int enable, uint32_t window_us) {
+            if (INVALID_HTCPLINK == lnk_) {
+                return -1;
+            }
+
+            if (enable > 0) {
+                gate_writes();
+                std::lock_guard < decltype(cork_lock_) > guard(cork_lock_);
+                cork_window_ = window_us;
+                if (0 == cork_) {
+                    if (::tcp_setattr(lnk_, LINKATTR_TCP_NO_BUILD, 1) < 0) {
+                        return -1;
+                    }
+                    cork_ = 1;
+                }
+                return 0;
+            }
+
+            // writes have been gated since cork mode enabled, the order of the two changes below is not visible to them
+            std::lock_guard < decltype(cork_lock_) > guard(cork_lock_);
+            if (cork_ > 0) {
+                flush_locked();
+                ::tcp_setattr(lnk_, LINKATTR_TCP_NO_BUILD, 0);
+                cork_ = 0;
+            }
+            return 0;
+        }
+
+        // called with @cork_lock_ held
+        int obtcp::cork(const void *origin, int cb, const nis_serializer_t serializer) {
+            std::size_t offset = cork_buffer_.size();
+            try {
+                cork_buffer_.resize(offset + frame_head(&tst_) + cb);
+            } catch (...) {
+                return -1;
+            }
+            if (frame(&cork_buffer_[offset], &tst_, origin, cb, serializer) < 0) {
+                cork_buffer_.resize(offset);
+                return -1;
+            }
+            ++coalesced_writes_;
+
+            // the receive callback of this link will flush when it returned
+            if (dispatching_object == this && cork_buffer_.size() < kMaximumCorkBytes) {
+                return 0;
+            }
+
+            if (cork_buffer_.size() >= kMaximumCorkBytes) {
+                return flush_locked();
+            }
+
+            if (0 == offset) {
+                // hold the merged sends for the window, then flush them on the timer thread
+                if (cork_window_ > 0 && delay_flush() >= 0) {
+                    return 0;
+                }
+                // sends issued before the I/O thread of this link wake up are merged, it flush them all in @on_pipedata
+                static const unsigned char awaken = 0;
+                ::tcp_awaken(lnk_, &awaken, sizeof (awaken));
+            }
+            return 0;
+        }
+
+        int obtcp::delay_flush() {
+            return schedule(cork_window_, [] (obtcp &object) {
+                object.flush();
+            });
+        }
+
+        // the expiry is posted to the hand-off worker of this link(if any), so the timers touch the session state on
+        // the same thread and core as it's callbacks, otherwise it run on the timer thread
+        int obtcp::schedule(const uint32_t delay_us, void (*routine)(obtcp &)) {
+            std::weak_ptr<obtcp> wptr;
+            try {
+                wptr = shared_from_this();
+            } catch (...) {
+                return -1;
+            }
+
+            return nsp::toolkit::singleton<link_timer>::instance()->schedule(delay_us, [wptr, routine] () {
+                auto object = wptr.lock();
+                if (!object) {
+                    return;
+                }
+
+                int worker = object->worker_;
+                if (worker < 0 || nsp::toolkit::singleton<handoff>::instance()->post_routine(object, worker, [object, routine] () {
+                        routine(*object);
+                    }) < 0) {
+                    routine(*object);
+                }
+            });
+        }
+
+        int obtcp::flush_locked() {
+            if (cork_buffer_.empty()) {
+                return 0;
+            }
+
+            ++raw_writes_;
+            submitted_bytes_.fetch_add(cork_buffer_.size(), std::memory_order_relaxed);
+            int retval = ::tcp_write(lnk_, cork_buffer_.data(), (int) cork_buffer_.size(), NULL);
+            if (retval < 0) {
+                submitted_bytes_.fetch_sub(cork_buffer_.size(), std::memory_order_relaxed);
+            }
+            cork_buffer_.clear();
+            return retval;
+        }
+
+        int obtcp::flush() {
+            if (0 == cork_) {
+                return 0;
+            }
+            std::lock_guard < decltype(cork_lock_) > guard(cork_lock_);
+            return flush_locked();
+        }
+
+        void obtcp::corkstat(uint64_t &coalesced, uint64_t &raw) const {
+            coalesced = coalesced_writes_.load(std::memory_order_relaxed);
+            raw = raw_writes_.load(std::memory_order_relaxed);
+        }
+
+        void obtcp::on_pipedata() {
+            flush();
+            check_watermark(0);
+        }
+
+        ///////////////////////////////////////		backpressure ///////////////////////////////////////
+        int obtcp::setwatermark(uint32_t low, uint32_t high) {
+            if (high > 0 && low > high) {
+                return -1;
+            }
+            low_watermark_ = low;
+            high_watermark_ = high;
+            if (0 == high) {
+                backpressure_ = 0;
+            }
+            return 0;
+        }
+
+        // interval of the re-check while backpressured, the peer may never send anything to trigger it
+        static const uint32_t kWatermarkRecheckUs = 10000;
+
+        int64_t obtcp::sample_pending() {
+            int64_t pending = 0;
+            if (cork_ > 0) {
+                std::lock_guard < decltype(cork_lock_) > guard(cork_lock_);
+                pending += cork_buffer_.size();
+            }
+
+#if !_WIN32
+            // bytes handed to nshost but not acknowledged by the peer yet, include both the queue inside nshost
+            // and the send queue of kernel, the later alone is capped near the socket send buffer size
+            struct tcp_info info;
+            int len = sizeof (info);
+            if (::tcp_getopt(lnk_, IPPROTO_TCP, TCP_INFO, (char *) &info, &len) >= 0) {
+                if (len >= (int) (offsetof(struct tcp_info, tcpi_bytes_acked) + sizeof (info.tcpi_bytes_acked))) {
+                    int64_t unacked = submitted_bytes_.load(std::memory_order_relaxed) - (int64_t) info.tcpi_bytes_acked;
+                    pending += ((unacked > 0) ? unacked : 0);
+                } else if (len >= (int) (offsetof(struct tcp_info, tcpi_notsent_bytes) + sizeof (info.tcpi_notsent_bytes))) {
+                    // kernel older than 4.1 do not report the acknowledged bytes, the unsent bytes of kernel is the best it can do
+                    pending += info.tcpi_notsent_bytes;
+                }
+            }
+#endif
+            pending_bound_ = pending;
+            return pending;
+        }
+
+        void obtcp::check_watermark(const int queued) {
+            uint32_t high = high_watermark_.load(std::memory_order_relaxed);
+            if (0 == high) {
+                return;
+            }
+
+            int64_t bound = pending_bound_.fetch_add(queued, std::memory_order_relaxed) + queued;
+            if (0 == backpressure_) {
+                // pending bytes can not reach the high watermark unless the bound did, skip the sample syscall
+                if (bound < high) {
+                    return;
+                }
+            } else if (queued > 0) {
+                // sends never release the backpressure
+                return;
+            }
+            update_watermark(sample_pending());
+        }
+
+        void obtcp::update_watermark(const int64_t pending) {
+            uint32_t high = high_watermark_.load(std::memory_order_relaxed);
+            if (0 == high) {
+                return;
+            }
+
+            int expected;
+            if (pending >= high) {
+                expected = 0;
+                if (backpressure_.compare_exchange_strong(expected, 1)) {
+                    on_backpressure();
+                    arm_recheck();
+                }
+            } else if (pending <= low_watermark_.load(std::memory_order_relaxed)) {
+                expected = 1;
+                if (backpressure_.compare_exchange_strong(expected, 0)) {
+                    on_writable();
+                }
+            }
+        }
+
+        // keep one chain of timer re-checks alive while backpressured, so @on_writable is raised even if
+        // nothing is sent or received on the link any more
+        void obtcp::arm_recheck() {
+            if (0 == backpressure_ || recheck_armed_.exchange(1) > 0) {
+                return;
+            }
+
+            if (schedule(kWatermarkRecheckUs, [] (obtcp &object) {
+                    object.recheck_watermark();
+                }) < 0) {
+                recheck_armed_ = 0;
+            }
+        }
+
+        void obtcp::recheck_watermark() {
+            // disarmed before the check, a backpressure raised concurrently either see it disarmed or is seen here
+            recheck_armed_ = 0;
+            if (0 == backpressure_ || INVALID_HTCPLINK == lnk_) {
+                return;
+            }
+            update_watermark(sample_pending());
+            arm_recheck();
+        }
+
+        int obtcp::sethandoff(int enable) {
+            // packets already queued on the worker would be overtaken by the ones delivered on the I/O thread(or the reverse),
+            // and @deliver would run concurrently on this object, so the mode is fixed once the link can raise events
+            if (attached_ > 0) {
+                return ((enable > 0) == (worker_ >= 0)) ? 0 : -1;
+            }
+
+            if (enable > 0) {
+                if (worker_ < 0) {
+                    worker_ = nsp::toolkit::singleton<handoff>::instance()->assign();
+                }
+            } else {
+                worker_ = -1;
+            }
+            return 0;
+        }
+
+        int obtcp::gethandoff() const {
+            return ((worker_ >= 0) ? 1 : 0);
+        }
+
+        int obtcp::post_routine(const std::function<void()> &routine) {
+            int worker = worker_;
+            if (worker < 0) {
+                return -1;
+            }
+            return nsp::toolkit::singleton<handoff>::instance()->post_routine(shared_from_this(), worker, routine);
+        }
+
+        void obtcp::counter(link_counter &lnk_counter) const {
+            counters_.load(lnk_counter);
+        }
+
+        int64_t obtcp::pending_bytes() {
+            int64_t pending = sample_pending();
+            update_watermark(pending);
+            return pending;
+        }
+
+        bool obtcp::backpressured() const {
+            return (0 != backpressure_);
+        }
+
+        void obtcp::on_backpressure() {
+            ;
+        }
+
+        void obtcp::on_writable() {
+            ;
+        }
+
+        // the largest user frame accepted in batch mode, same as nshost limit the frames it split itself
+        static const int kMaximumFrameBytes = (50 << 20);
+
+        // split the raw stream into frames by @tst_, incomplete tail bytes are kept in @pending_ for next read.
+        // return the count of frames delivered
+        int obtcp::split(const unsigned char *data, const int cb) {
+            if (!tst_.parser_ || tst_.cb_ <= 0) {
+                packet_view pkt(data, cb);
+                on_recvbatch(&pkt, 1);
+                return 1;
+            }
+
+            const unsigned char *cursor = data;
+            int remain = cb;
+            if (pending_.size() > 0) {
+                pending_.append(data, cb);
+                cursor = pending_.data();
+                remain = (int) pending_.size();
+            }
+
+            batch_pkts_.clear();
+            while (remain >= tst_.cb_) {
+                int user_size = 0;
+                // a head announcing a huge frame would make @pending_ grow without bound, treat it as a parse failure
+                if (tst_.parser_((void *) cursor, remain, &user_size) < 0 || user_size < 0 || user_size > kMaximumFrameBytes) {
+                    return -1;
+                }
+                if (remain - tst_.cb_ < user_size) {
+                    break;
+                }
+                batch_pkts_.push_back(packet_view(cursor + tst_.cb_, user_size));
+                cursor += tst_.cb_ + user_size;
+                remain -= tst_.cb_ + user_size;
+            }
+
+            if (batch_pkts_.size() > 0) {
+                on_recvbatch(batch_pkts_.data(), (int) batch_pkts_.size());
+            }
+
+            // views point into @pending_, so the tail can only be moved after delivery
+            if (pending_.size() > 0) {
+                pending_.erase(0, pending_.size() - remain);
+            } else if (remain > 0) {
+                pending_.assign(cursor, remain);
+            }
+            return (int) batch_pkts_.size();
         }
 
         int obtcp::create(const char *epstr) {
@@ -54,6 +523,7 @@ namespace nsp {
             }
 
             std::string ipstr = ep.ipv4();
+            attached_ = 1;
             try {
                 if (nsp::toolkit::singleton<swnet>::instance()->tcp_create(
                         shared_from_this(), ipstr.size() > 0 ? ipstr.c_str() : nullptr, ep.port()) < 0) {
@@ -63,7 +533,7 @@ namespace nsp {
                 return -1;
             }
 
-            ::tcp_settst(lnk_, &tst_);
+            settst(&tst_);
             return 0;
         }
 
@@ -74,6 +544,7 @@ namespace nsp {
         std::weak_ptr<obtcp> obtcp::attach() {
             try {
                 auto sptr = shared_from_this();
+                attached_ = 1;
                 if (nsp::toolkit::singleton<swnet>::instance()->tcp_attach(lnk_, sptr) < 0) {
                     return std::weak_ptr<obtcp>();
                 }
@@ -174,12 +645,12 @@ namespace nsp {
 			return 0;
 		}
 
-        int obtcp::listen() {
-            if (INVALID_HTCPLINK == lnk_) {
+        int obtcp::listen(int backlog) {
+            if (INVALID_HTCPLINK == lnk_ || backlog <= 0) {
                 return -1;
             }
 
-            if (::tcp_listen(lnk_, 5) < 0) {
+            if (::tcp_listen(lnk_, backlog) < 0) {
                 return -1;
             }
 
@@ -198,18 +669,56 @@ namespace nsp {
         // 直接发送或者组包发送的基本方法
         int obtcp::send(const unsigned char *data, int cb) {
             if (INVALID_HTCPLINK != lnk_ && cb > 0 && data) {
-                return ::tcp_write(lnk_, data, cb, NULL);
+                return write(data, cb, NULL);
             }
             return -1;
         }
 
         int obtcp::send(const void *origin, int cb, const nis_serializer_t serializer) {
             if (INVALID_HTCPLINK != lnk_ && cb > 0 && origin && serializer) {
-                return ::tcp_write(lnk_, origin, cb, serializer);
+                return write(origin, cb, serializer);
             }
             return -1;
         }
 
+        // the origin which delivered to @iov_serialize for gather send
+        struct iov_origin {
+            const packet_view *segments_;
+            int count_;
+        };
+
+        static int STD_CALL iov_serialize(unsigned char *packet, const void *origin, int cb) {
+            const iov_origin *iov = (const iov_origin *) origin;
+            for (int i = 0; i < iov->count_; i++) {
+                if (iov->segments_[i].size() > 0) {
+                    memcpy(packet, iov->segments_[i].data(), iov->segments_[i].size());
+                    packet += iov->segments_[i].size();
+                }
+            }
+            return 0;
+        }
+
+        int obtcp::send_iov(const packet_view *segments, int count) {
+            if (INVALID_HTCPLINK == lnk_ || !segments || count <= 0) {
+                return -1;
+            }
+
+            // the total is passed to nshost as int, it must not overflow
+            int64_t cb = 0;
+            for (int i = 0; i < count; i++) {
+                if (segments[i].size() < 0 || (segments[i].size() > 0 && !segments[i].data())) {
+                    return -1;
+                }
+                cb += segments[i].size();
+            }
+            if (cb <= 0 || cb > INT_MAX) {
+                return -1;
+            }
+
+            iov_origin iov = {segments, count};
+            return write(&iov, (int) cb, &iov_serialize);
+        }
+
         const endpoint &obtcp::local() const {
             return local_;
         }
@@ -230,6 +739,11 @@ namespace nsp {
             HTCPLINK previous = lnk_.exchange(INVALID_HTCPLINK);
             if (INVALID_HTCPLINK != previous) {
                 nsp::toolkit::singleton<swnet>::instance()->tcp_detach(previous);
+                // queued behind the packets of this link, so @on_closed is always the last notification
+                int worker = worker_;
+                if (worker >= 0 && nsp::toolkit::singleton<handoff>::instance()->post_closed(shared_from_this(), worker, previous) >= 0) {
+                    return;
+                }
                 on_closed(previous);
             }
         }
@@ -252,10 +766,43 @@ namespace nsp {
             ;
         }
 
+        void obtcp::on_recvdata(const packet_view &pkt) {
+            on_recvdata(pkt.to_string());
+        }
+
+        void obtcp::on_recvbatch(const packet_view *pkts, const int count) {
+            for (int i = 0; i < count; i++) {
+                on_recvdata(pkts[i]);
+            }
+        }
+
         void obtcp::on_recvdata(const unsigned char *data, const int cb) {
             if (data && cb > 0) {
-                on_recvdata(std::basic_string<unsigned char>(data, cb));
+                // deliver on the I/O thread if the packet can not be queued
+                int worker = worker_;
+                if (worker >= 0 && nsp::toolkit::singleton<handoff>::instance()->post(shared_from_this(), worker, data, cb) >= 0) {
+                    return;
+                }
+                deliver(data, cb);
+            }
+        }
+
+        void obtcp::deliver(const unsigned char *data, const int cb) {
+            const obtcp *previous = dispatching_object;
+            dispatching_object = this;
+            uint64_t begin = os::clock_gettime();
+            int packets = 1;
+            if (0 == batch_) {
+                on_recvdata(packet_view(data, cb));
+            } else if ((packets = split(data, cb)) < 0) {
+                // the stream can not be parsed any more, same as nshost did when template parser failed
+                packets = 0;
+                close();
             }
+            counters_.received(packets, cb, begin, os::clock_gettime());
+            dispatching_object = previous;
+            flush();
+            check_watermark(0);
         }
 
         void obtcp::on_accepted(HTCPLINK lnk) {
@@ -342,18 +889,26 @@ namespace nsp {
 
         int obudp::sendto(const unsigned char *data, int cb, const endpoint &ep) {
             if (INVALID_HUDPLINK != lnk_ && data && cb > 0) {
-                return ::udp_write(lnk_, data, cb, ep.ipv4(), ep.port(), NULL);
+                int retval = ::udp_write(lnk_, data, cb, ep.ipv4(), ep.port(), NULL);
+                counters_.sent(1, cb, retval);
+                return retval;
             }
             return -1;
         }
 
         int obudp::sendto(const void *origin, int cb, const endpoint &ep, const nis_serializer_t serializer) {
             if (INVALID_HUDPLINK != lnk_ && cb > 0 && origin && serializer) {
-                return ::udp_write(lnk_, origin, cb, ep.ipv4(), ep.port(), serializer);
+                int retval = ::udp_write(lnk_, origin, cb, ep.ipv4(), ep.port(), serializer);
+                counters_.sent(1, cb, retval);
+                return retval;
             }
             return -1;
         }
 
+        void obudp::counter(link_counter &lnk_counter) const {
+            counters_.load(lnk_counter);
+        }
+
         const endpoint &obudp::local() const {
             return local_;
         }
@@ -361,9 +916,39 @@ namespace nsp {
         void obudp::on_recvdata(const std::basic_string<unsigned char> &data, const endpoint &r_ep) {
         }
 
+        void obudp::on_recvdata(const packet_view &data, const u32_ipv4_t ipv4, const port_t port) {
+            endpoint r_ep;
+            r_ep.ipv4(ipv4);
+            r_ep.port(port);
+            on_recvdata(data.to_string(), r_ep);
+        }
+
+        // nshost always report the sender in dotted decimal notation, convert it without any allocation or validation.
+        // the result is the same as toolkit::ipv4_touint(ipaddr, kByteOrder_LittleEndian)
+        static u32_ipv4_t dotted_ipv4(const char *ipaddr) {
+            u32_ipv4_t ipv4 = 0;
+            u32_ipv4_t segment = 0;
+            int shift = 24;
+            for (const char *p = ipaddr; *p && shift >= 0; p++) {
+                if ('.' == *p) {
+                    ipv4 |= (segment & 0xFF) << shift;
+                    segment = 0;
+                    shift -= 8;
+                } else {
+                    segment = segment * 10 + (*p - '0');
+                }
+            }
+            if (shift >= 0) {
+                ipv4 |= (segment & 0xFF) << shift;
+            }
+            return ipv4;
+        }
+
         void obudp::on_recvdata(const unsigned char *data, const int cb, const char *ipaddr, const port_t port) {
             if (INVALID_HUDPLINK != lnk_ && data && cb > 0 && ipaddr && port > 0) {
-                on_recvdata(std::basic_string<unsigned char>(data, cb), endpoint(ipaddr, port));
+                uint64_t begin = os::clock_gettime();
+                on_recvdata(packet_view(data, cb), dotted_ipv4(ipaddr), port);
+                counters_.received(1, cb, begin, os::clock_gettime());
             }
         }
 
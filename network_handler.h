@@ -9,6 +9,9 @@
 #include <functional>
 #include <atomic>
 #include <memory>
+#include <vector>
+#include <utility>
+#include <mutex>
 
 #include "endpoint.h"
 #include "icom/nisdef.h"
@@ -16,7 +19,81 @@
 namespace nsp {
     namespace tcpip {
 
+        // non-owning view of the bytes of a received packet,
+        // the memory is owned by nshost and only valid until the callback it passed to returns
+        struct packet_view {
+            packet_view() : data_(nullptr), size_(0) {
+            }
+
+            packet_view(const unsigned char *data, const int size) : data_(data), size_(size) {
+            }
+
+            const unsigned char *data() const {
+                return data_;
+            }
+
+            int size() const {
+                return size_;
+            }
+
+            bool empty() const {
+                return (!data_ || size_ <= 0);
+            }
+
+            const unsigned char *begin() const {
+                return data_;
+            }
+
+            const unsigned char *end() const {
+                return data_ + size_;
+            }
+
+            const unsigned char &operator[](const int i) const {
+                return data_[i];
+            }
+
+            // copy the bytes out when the packet must be kept after the callback
+            std::basic_string<unsigned char> to_string() const {
+                return std::basic_string<unsigned char>(data_, size_);
+            }
+
+            const unsigned char *data_;
+            int size_;
+        };
+
+        // sampled counters of one link, times are in 100ns units same as os::clock_gettime
+        struct link_counter {
+            uint64_t bytes_in_;
+            uint64_t packets_in_;
+            uint64_t bytes_out_;
+            uint64_t packets_out_;
+            uint64_t send_failures_;
+            uint64_t max_recv_time_; // the longest single receive callback
+            uint64_t idle_; // elapsed since the last receive or successful send
+        };
+
+        // per-link counters, updated with relaxed atomics by the I/O thread and senders, sampled without any lock
+        class link_counters {
+        public:
+            void received(const int packets, const int bytes, const uint64_t begin, const uint64_t end);
+            void sent(const int packets, const int bytes, const int retval);
+            void load(link_counter &counter) const;
+
+        private:
+            std::atomic<uint64_t> bytes_in_{0};
+            std::atomic<uint64_t> packets_in_{0};
+            std::atomic<uint64_t> bytes_out_{0};
+            std::atomic<uint64_t> packets_out_{0};
+            std::atomic<uint64_t> send_failures_{0};
+            std::atomic<uint64_t> max_recv_time_{0};
+            std::atomic<uint64_t> last_activity_{0};
+        };
+
+        class handoff_task;
+
         class obtcp : public std::enable_shared_from_this<obtcp> {
+            friend class handoff_task;
+
         public:
             obtcp();
             obtcp(const HTCPLINK lnk);
@@ -32,9 +109,13 @@ namespace nsp {
             int connect(const endpoint &ep);
             int connect2(const char *epstr);
             int connect2(const endpoint &ep);
-            int listen();
+            // @backlog is the maximum length of pending connections queue
+            int listen(int backlog = 5);
             int send(const void *origin, int cb, const nis_serializer_t serializer);
             int send(const unsigned char *data, int cb);
+            // gather send, all @segments are framed as one packet by @tst_t::builder_ and copied directly
+            // into the send buffer of nshost, no contiguous staging copy required
+            int send_iov(const packet_view *segments, int count);
             const endpoint &local() const;
             const endpoint &remote() const;
 
@@ -46,12 +127,49 @@ namespace nsp {
                 settst(&tst_);
             }
 
+            // batch receive mode, all frames split from one kernel read are delivered by a single @on_recvbatch call.
+            // in this mode nshost hand over the raw stream and the framing of both direction is done by this object with @tst_,
+            // it should be enabled before any data transfered on the link. a frame head announcing more than 50MB closes the link
+            int setbatch(int enable);
+
+            // write coalescing(cork) mode, sends are framed by this object and merged into one write of nshost.
+            // sends issued inside the receive callback of this link are flushed when the callback returned,
+            // others are flushed @window_us microseconds after the first merged send by @link_timer(on the hand-off worker if enabled),
+            // with @window_us zero by the I/O thread awakened by the first merged send, or when the merged size reach the limit.
+            // once enabled, every send of this link(even after disabled) is serialized by a lock, so switching the mode is safe
+            // with concurrent senders, but it must not be called inside a serializer of this link. @flush can be called at any time
+            int setcork(int enable, uint32_t window_us = 0);
+            int flush();
+            // @coalesced: sends merged into cork buffer, @raw: writes actually submitted to nshost
+            void corkstat(uint64_t &coalesced, uint64_t &raw) const;
+
+            // send side backpressure, @on_backpressure is called when pending bytes reach @high,
+            // @on_writable is called when they fall back to @low or below, @high equal to zero disable the watermarks.
+            // nshost has no writable event, the state is re-evaluated on send, on receive, on pipe wakeup, by @pending_bytes,
+            // and every 10ms by @link_timer(on the hand-off worker if enabled) while backpressured
+            int setwatermark(uint32_t low, uint32_t high);
+            // bytes accepted by @send but not yet acknowledged by the peer: cork buffer, queue of nshost and send queue of kernel
+            int64_t pending_bytes();
+            bool backpressured() const;
+            void counter(link_counter &lnk_counter) const;
+
+            // hand-off dispatch mode, received packets and the close notification of this link are handled
+            // in order on the worker thread of @handoff assigned to this link instead of the nshost I/O thread.
+            // it must be set before @create or @attach, later changes are rejected(return -1) because the packets
+            // queued on the worker would be overtaken by the ones delivered on the I/O thread
+            int sethandoff(int enable);
+            int gethandoff() const;
+            // run @routine on the worker of this link, ordered with it's callbacks, so that timers or any other
+            // work on the session state stay on the same thread(and core, see @handoff::setaffinity). fails if hand-off disabled
+            int post_routine(const std::function<void()> &routine);
+
             void setlnk(const HTCPLINK lnk);
 
             void on_recvdata(const unsigned char *data, const int cb);
             void on_accepted(HTCPLINK srv, HTCPLINK client);
             void on_closed();
             void on_connected2();
+            void on_pipedata();
 
             virtual void on_connected();
             virtual void bind_object(const std::shared_ptr<obtcp> &object);
@@ -59,8 +177,17 @@ namespace nsp {
 
         protected:
             virtual void on_closed(HTCPLINK previous);
+            // zero-copy receive, @pkt is borrowed from nshost and only valid during this call.
+            // the default implementation copy @pkt into a string and forward to the compatible overload below
+            virtual void on_recvdata(const packet_view &pkt);
             virtual void on_recvdata(const std::basic_string<unsigned char> &pkt);
+            // batch receive, every element of @pkts is borrowed and only valid during this call.
+            // the default implementation deliver each packet to @on_recvdata(const packet_view &) in order
+            virtual void on_recvbatch(const packet_view *pkts, const int count);
             virtual void on_accepted(HTCPLINK lnk);
+            // watermark notifications, called on the thread which detect the change
+            virtual void on_backpressure();
+            virtual void on_writable();
 
             std::atomic<HTCPLINK> lnk_{INVALID_HTCPLINK};
             endpoint remote_;
@@ -69,6 +196,47 @@ namespace nsp {
 
         private:
             void settst(tst_t *tst);
+            void deliver(const unsigned char *data, const int cb);
+            int write(const void *origin, int cb, const nis_serializer_t serializer);
+            int submit(const void *origin, int cb, const nis_serializer_t serializer);
+            int64_t sample_pending();
+            void check_watermark(const int queued);
+            void update_watermark(const int64_t pending);
+            void arm_recheck();
+            void recheck_watermark();
+            void gate_writes();
+            int cork(const void *origin, int cb, const nis_serializer_t serializer);
+            int delay_flush();
+            int schedule(const uint32_t delay_us, void (*routine)(obtcp &));
+            int flush_locked();
+            int split(const unsigned char *data, const int cb);
+
+            std::atomic<int> batch_{0};
+            std::basic_string<unsigned char> pending_;
+            std::vector<packet_view> batch_pkts_;
+
+            std::atomic<int> cork_{0};
+            std::atomic<int> cork_gated_{0};
+            std::atomic<int> ungated_writes_{0};
+            uint32_t cork_window_ = 0; // microseconds, guarded by @cork_lock_
+            std::basic_string<unsigned char> cork_buffer_;
+            std::mutex cork_lock_;
+            std::atomic<uint64_t> coalesced_writes_{0};
+            std::atomic<uint64_t> raw_writes_{0};
+
+            std::atomic<uint32_t> low_watermark_{0};
+            std::atomic<uint32_t> high_watermark_{0};
+            std::atomic<int> backpressure_{0};
+            std::atomic<int> recheck_armed_{0};
+            // bytes handed to nshost including frame heads, compared with the bytes acknowledged by the peer
+            std::atomic<int64_t> submitted_bytes_{0};
+            // upper bound of pending bytes since the last sample, pending bytes never grow without a send
+            std::atomic<int64_t> pending_bound_{0};
+
+            link_counters counters_;
+            std::atomic<int> worker_{-1}; // the hand-off worker assigned, negative when hand-off disabled
+            std::atomic<int> attached_{0}; // registered in @swnet by @create or @attach, events may be raised since then
+
             obtcp(const obtcp &rf) = delete;
             obtcp(obtcp &&) = delete;
             obtcp &operator=(const obtcp &) = delete;
@@ -86,6 +254,7 @@ namespace nsp {
             void close();
             int sendto(const unsigned char *data, int cb, const endpoint &ep);
             int sendto(const void *origin, int cb, const endpoint &ep, const nis_serializer_t serializer);
+            void counter(link_counter &lnk_counter) const;
 
             const endpoint &local() const;
             void setlnk(const HUDPLINK lnk);
@@ -97,10 +266,16 @@ namespace nsp {
             std::atomic<HUDPLINK> lnk_{INVALID_HUDPLINK};
             endpoint local_;
 
+            // zero-copy receive, @data is borrowed from nshost and only valid during this call,
+            // the sender address is given in binary(same layout as @endpoint::ipv4_uint32) without any text parsing.
+            // the default implementation build a string and a endpoint and forward to the compatible overload below
+            virtual void on_recvdata(const packet_view &data, const u32_ipv4_t ipv4, const port_t port);
             virtual void on_recvdata(const std::basic_string<unsigned char> &data, const endpoint &r_ep);
             virtual void on_closed(HUDPLINK previous);
 
         private:
+            link_counters counters_;
+
             obudp(const obudp &) = delete;
             obudp(obudp &&) = delete;
             obudp &operator=(const obudp &) = delete;
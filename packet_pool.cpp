@@ -0,0 +1,345 @@
+﻿#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "packet_pool.h"
+
+namespace nsp {
+    namespace tcpip {
+
+        static const int kSlabClasses = 5;
+        static const int kSlabCapacity[kSlabClasses] = {256, 1024, 4096, 16384, 65536};
+        static const int kLargeClass = kSlabClasses;
+        // upper limit of the bytes one thread can cache in each slab class
+        static const int kMaximumCachedBytes = (4 << 20);
+
+        struct thread_packet_pool;
+
+        struct packet_block {
+            std::atomic<int> refcnt_;
+            int size_;
+            int capacity_;
+            int class_;
+            thread_packet_pool *owner_;
+            packet_block *next_;
+
+            unsigned char *data() {
+                return reinterpret_cast<unsigned char *> (this + 1);
+            }
+        };
+
+        struct thread_packet_pool {
+            packet_block *free_[kSlabClasses];
+            int cached_[kSlabClasses];
+            // buffers released by other threads, pushed without lock and taken all at once by the owner
+            std::atomic<packet_block *> remote_[kSlabClasses];
+            std::atomic<uint64_t> hits_{0};
+            std::atomic<uint64_t> misses_{0};
+            // outstanding buffers plus one reference held by the owner thread itself
+            std::atomic<int64_t> outstanding_{1};
+            std::atomic<int64_t> high_water_{0};
+            std::atomic<int> orphan_{0};
+
+            thread_packet_pool() {
+                for (int i = 0; i < kSlabClasses; i++) {
+                    free_[i] = nullptr;
+                    cached_[i] = 0;
+                    remote_[i].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        static std::mutex pool_registry_lock;
+        static std::vector<thread_packet_pool *> pool_registry;
+        static packet_pool_stat retired_stat = {0, 0, 0, 0, 0};
+
+        static void free_chain(packet_block *block) {
+            while (block) {
+                packet_block *next = block->next_;
+                free(block);
+                block = next;
+            }
+        }
+
+        static thread_packet_pool *create_pool() {
+            thread_packet_pool *pool = new thread_packet_pool;
+            std::lock_guard < decltype(pool_registry_lock) > guard(pool_registry_lock);
+            pool_registry.push_back(pool);
+            return pool;
+        }
+
+        static void destroy_pool(thread_packet_pool *pool) {
+            {
+                std::lock_guard < decltype(pool_registry_lock) > guard(pool_registry_lock);
+                retired_stat.hits_ += pool->hits_.load(std::memory_order_relaxed);
+                retired_stat.misses_ += pool->misses_.load(std::memory_order_relaxed);
+                retired_stat.high_water_ = std::max<int64_t>(retired_stat.high_water_, pool->high_water_.load(std::memory_order_relaxed));
+                auto iter = std::find(pool_registry.begin(), pool_registry.end(), pool);
+                if (pool_registry.end() != iter) {
+                    pool_registry.erase(iter);
+                }
+            }
+
+            for (int i = 0; i < kSlabClasses; i++) {
+                free_chain(pool->free_[i]);
+                free_chain(pool->remote_[i].exchange(nullptr));
+            }
+            delete pool;
+        }
+
+        static void deref_pool(thread_packet_pool *pool) {
+            if (1 == pool->outstanding_.fetch_sub(1, std::memory_order_acq_rel)) {
+                destroy_pool(pool);
+            }
+        }
+
+        // the pool of exiting thread become orphan, it will be destroyed by the last release of it's outstanding buffers
+        struct local_pool_holder {
+            thread_packet_pool *pool_ = nullptr;
+
+            ~local_pool_holder() {
+                thread_packet_pool *pool = pool_;
+                pool_ = nullptr;
+                if (pool) {
+                    pool->orphan_.store(1, std::memory_order_release);
+                    for (int i = 0; i < kSlabClasses; i++) {
+                        free_chain(pool->free_[i]);
+                        pool->free_[i] = nullptr;
+                        pool->cached_[i] = 0;
+                        free_chain(pool->remote_[i].exchange(nullptr, std::memory_order_acquire));
+                    }
+                    deref_pool(pool);
+                }
+            }
+        };
+
+        static thread_local local_pool_holder local_pool;
+
+        static int slab_class(const int size) {
+            for (int i = 0; i < kSlabClasses; i++) {
+                if (size <= kSlabCapacity[i]) {
+                    return i;
+                }
+            }
+            return kLargeClass;
+        }
+
+        static packet_block *allocate_block(const int cls, const int size) {
+            int capacity = ((kLargeClass == cls) ? size : kSlabCapacity[cls]);
+            packet_block *block = (packet_block *) malloc(sizeof (packet_block) + capacity);
+            if (block) {
+                new (&block->refcnt_) std::atomic<int>(0);
+                block->capacity_ = capacity;
+                block->class_ = cls;
+                block->next_ = nullptr;
+            }
+            return block;
+        }
+
+        // take the buffers released by other threads into the free list of owner, the cache limit of the class applies to them too,
+        // otherwise a pool acquired on one thread and released on another(I/O thread and hand-off worker) is never trimmed
+        static void splice_remote(thread_packet_pool *pool, const int cls) {
+            packet_block *remote = pool->remote_[cls].exchange(nullptr, std::memory_order_acquire);
+            while (remote && (pool->cached_[cls] + 1) * kSlabCapacity[cls] <= kMaximumCachedBytes) {
+                packet_block *next = remote->next_;
+                remote->next_ = pool->free_[cls];
+                pool->free_[cls] = remote;
+                pool->cached_[cls]++;
+                remote = next;
+            }
+            free_chain(remote);
+        }
+
+        static packet_block *acquire_block(const int size) {
+            if (!local_pool.pool_) {
+                local_pool.pool_ = create_pool();
+            }
+            thread_packet_pool *pool = local_pool.pool_;
+
+            int cls = slab_class(size);
+            packet_block *block = nullptr;
+            if (cls < kSlabClasses) {
+                if (!pool->free_[cls]) {
+                    splice_remote(pool, cls);
+                }
+                block = pool->free_[cls];
+                if (block) {
+                    pool->free_[cls] = block->next_;
+                    pool->cached_[cls]--;
+                    pool->hits_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            if (!block) {
+                block = allocate_block(cls, size);
+                if (!block) {
+                    return nullptr;
+                }
+                pool->misses_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            block->refcnt_.store(1, std::memory_order_relaxed);
+            block->size_ = size;
+            block->owner_ = pool;
+            block->next_ = nullptr;
+
+            int64_t outstanding = pool->outstanding_.fetch_add(1, std::memory_order_relaxed);
+            if (outstanding > pool->high_water_.load(std::memory_order_relaxed)) {
+                pool->high_water_.store(outstanding, std::memory_order_relaxed);
+            }
+            return block;
+        }
+
+        static void release_block(packet_block *block) {
+            if (1 != block->refcnt_.fetch_sub(1, std::memory_order_acq_rel)) {
+                return;
+            }
+
+            thread_packet_pool *pool = block->owner_;
+            int cls = block->class_;
+            if (kLargeClass == cls) {
+                free(block);
+            } else if (pool == local_pool.pool_) {
+                if ((pool->cached_[cls] + 1) * kSlabCapacity[cls] <= kMaximumCachedBytes) {
+                    block->next_ = pool->free_[cls];
+                    pool->free_[cls] = block;
+                    pool->cached_[cls]++;
+                } else {
+                    free(block);
+                }
+            } else if (pool->orphan_.load(std::memory_order_acquire)) {
+                free(block);
+            } else {
+                packet_block *head = pool->remote_[cls].load(std::memory_order_relaxed);
+                do {
+                    block->next_ = head;
+                } while (!pool->remote_[cls].compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+            }
+            deref_pool(pool);
+        }
+
+        ///////////////////////////////////////		packet_ptr ///////////////////////////////////////
+        packet_ptr::packet_ptr() {
+            ;
+        }
+
+        packet_ptr::packet_ptr(packet_block *block) : block_(block) {
+            ;
+        }
+
+        packet_ptr::packet_ptr(const packet_ptr &lref) : block_(lref.block_) {
+            if (block_) {
+                block_->refcnt_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        packet_ptr::packet_ptr(packet_ptr &&rref) : block_(rref.block_) {
+            rref.block_ = nullptr;
+        }
+
+        packet_ptr &packet_ptr::operator=(const packet_ptr &lref) {
+            if (&lref != this) {
+                if (lref.block_) {
+                    lref.block_->refcnt_.fetch_add(1, std::memory_order_relaxed);
+                }
+                reset();
+                block_ = lref.block_;
+            }
+            return *this;
+        }
+
+        packet_ptr &packet_ptr::operator=(packet_ptr &&rref) {
+            if (&rref != this) {
+                reset();
+                block_ = rref.block_;
+                rref.block_ = nullptr;
+            }
+            return *this;
+        }
+
+        packet_ptr::~packet_ptr() {
+            reset();
+        }
+
+        unsigned char *packet_ptr::data() {
+            return (block_ ? block_->data() : nullptr);
+        }
+
+        const unsigned char *packet_ptr::data() const {
+            return (block_ ? block_->data() : nullptr);
+        }
+
+        int packet_ptr::size() const {
+            return (block_ ? block_->size_ : 0);
+        }
+
+        int packet_ptr::capacity() const {
+            return (block_ ? block_->capacity_ : 0);
+        }
+
+        int packet_ptr::resize(const int size) {
+            if (!block_ || size < 0 || size > block_->capacity_) {
+                return -1;
+            }
+            block_->size_ = size;
+            return 0;
+        }
+
+        packet_view packet_ptr::view() const {
+            return packet_view(data(), size());
+        }
+
+        void packet_ptr::reset() {
+            if (block_) {
+                release_block(block_);
+                block_ = nullptr;
+            }
+        }
+
+        ///////////////////////////////////////		packet_pool ///////////////////////////////////////
+        packet_ptr packet_pool::acquire(const int size) {
+            if (size < 0) {
+                return packet_ptr();
+            }
+            return packet_ptr(acquire_block(size));
+        }
+
+        packet_ptr packet_pool::retain(const unsigned char *data, const int size) {
+            if (!data || size <= 0) {
+                return packet_ptr();
+            }
+
+            packet_ptr pkt = acquire(size);
+            if (pkt) {
+                memcpy(pkt.data(), data, size);
+            }
+            return pkt;
+        }
+
+        packet_ptr packet_pool::retain(const packet_view &pkt) {
+            return retain(pkt.data(), pkt.size());
+        }
+
+        void packet_pool::stat(packet_pool_stat &pool_stat) {
+            std::lock_guard < decltype(pool_registry_lock) > guard(pool_registry_lock);
+            pool_stat = retired_stat;
+            pool_stat.pools_ = 0;
+            for (thread_packet_pool *pool : pool_registry) {
+                pool_stat.hits_ += pool->hits_.load(std::memory_order_relaxed);
+                pool_stat.misses_ += pool->misses_.load(std::memory_order_relaxed);
+                pool_stat.high_water_ = std::max<int64_t>(pool_stat.high_water_, pool->high_water_.load(std::memory_order_relaxed));
+                if (pool->orphan_.load(std::memory_order_acquire)) {
+                    pool_stat.outstanding_ += pool->outstanding_.load(std::memory_order_relaxed);
+                } else {
+                    pool_stat.outstanding_ += pool->outstanding_.load(std::memory_order_relaxed) - 1;
+                    pool_stat.pools_++;
+                }
+            }
+        }
+
+    } // namespace tcpip
+} // namespace nsp
@@ -0,0 +1,72 @@
+﻿#if !defined SWNET_PACKET_POOL_HEADER
+#define SWNET_PACKET_POOL_HEADER
+
+#include <cstdint>
+#include <cstddef>
+
+#include "network_handler.h"
+
+/*
+ *  reference counted packet buffers drawn from per-thread slab pools
+ *
+ *  the buffer is acquired on the calling thread (usually a nshost I/O thread inside the receive callback),
+ *  it can be copied (reference count only) and handed to any other thread, for example a worker of @task_thread_pool,
+ *  the last release return the buffer to the pool of the thread it acquired from, without any lock.
+ *  buffers larger than the biggest slab class are allocated from heap directly and counted as miss.
+ */
+
+namespace nsp {
+    namespace tcpip {
+
+        struct packet_block;
+
+        class packet_ptr {
+            packet_block *block_ = nullptr;
+
+            friend class packet_pool;
+            explicit packet_ptr(packet_block *block);
+
+        public:
+            packet_ptr();
+            packet_ptr(const packet_ptr &lref);
+            packet_ptr(packet_ptr &&rref);
+            packet_ptr &operator=(const packet_ptr &lref);
+            packet_ptr &operator=(packet_ptr &&rref);
+            ~packet_ptr();
+
+            unsigned char *data();
+            const unsigned char *data() const;
+            int size() const;
+            int capacity() const;
+            // change the valid length of the buffer, fail if @size exceed the capacity
+            int resize(const int size);
+            packet_view view() const;
+            void reset();
+
+            explicit operator bool() const {
+                return (nullptr != block_);
+            }
+        };
+
+        struct packet_pool_stat {
+            uint64_t hits_; // acquire satisfied by a cached buffer
+            uint64_t misses_; // acquire which allocate from heap
+            int64_t outstanding_; // buffers acquired and not yet released
+            int64_t high_water_; // the maximum outstanding buffers ever reached by one thread pool
+            int pools_; // thread pools currently alive
+        };
+
+        class packet_pool {
+        public:
+            // acquire a buffer with capacity not less than @size, the valid length is set to @size
+            static packet_ptr acquire(const int size);
+            // acquire a buffer and copy the borrowed bytes in, this is the only copy required to keep a received packet
+            static packet_ptr retain(const packet_view &pkt);
+            static packet_ptr retain(const unsigned char *data, const int size);
+            static void stat(packet_pool_stat &pool_stat);
+        };
+
+    } // namespace tcpip
+} // namespace nsp
+
+#endif // !SWNET_PACKET_POOL_HEADER
@@ -6,6 +6,8 @@
 #include <cstdint>
 #include <cstring>
 #include <cstdio>
+#include <type_traits>
+#include <utility>
 
 #include "toolkit.h"
 
@@ -117,6 +119,130 @@ namespace nsp {
         typedef proto_crt_t<float> proto_float32_t;
         typedef proto_crt_t<double> proto_float64_t;
 
+        // byte order of elements in big endian containers, only arithmetic value of 1/2/4/8 bytes can be swapped,
+        // the others(long double) have no @toolkit::byte_order_swapper and stay in host order as they always did
+        template<class T, bool SWAPPABLE = (std::is_arithmetic<T>::value && (1 == sizeof ( T) || 2 == sizeof ( T) || 4 == sizeof ( T) || 8 == sizeof ( T)))>
+        struct proto_element_order {
+
+            static T big_endian(const T &value) {
+                return value;
+            }
+        };
+
+        template<class T>
+        struct proto_element_order<T, true> {
+
+            static T big_endian(const T &value) {
+                return toolkit::change_byte_order(value);
+            }
+        };
+
+        // element codec of @proto_vector_t, the default one call the virtual methods of each element.
+        // @big_endian is ignored here, compound elements are in charge of their own byte order
+        template<class T, class Enable = void>
+        struct proto_vector_element {
+
+            static int length(const std::vector<T> &items) {
+                int sum = 0;
+                for (const T &iter : items) sum += iter.length();
+                return sum;
+            }
+
+            static unsigned char *serialize(const std::vector<T> &items, unsigned char *stream_pos, int big_endian) {
+                for (const T &iter : items) {
+                    stream_pos = iter.serialize(stream_pos);
+                    if (!stream_pos) return nullptr;
+                }
+                return stream_pos;
+            }
+
+            template<class NL>
+            static const unsigned char *build(std::vector<T> &items, const unsigned char *stream_pos, NL element_count, int &cb, int big_endian) {
+                for (NL i = 0; i < element_count; i++) {
+                    T item;
+                    stream_pos = item.build(stream_pos, cb);
+                    if (!stream_pos) return nullptr;
+                    items.push_back(std::move(item));
+                }
+                return stream_pos;
+            }
+        };
+
+        // fixed length elements, the bytes available are checked once and storage reserved before build
+        template<class T>
+        struct proto_vector_element<proto_crt_t<T>> {
+
+            static int length(const std::vector<proto_crt_t<T>> &items) {
+                return (int) (items.size() * sizeof ( T));
+            }
+
+            static unsigned char *serialize(const std::vector<proto_crt_t<T>> &items, unsigned char *stream_pos, int big_endian) {
+                for (const proto_crt_t<T> &iter : items) {
+                    T value = (big_endian ? proto_element_order<T>::big_endian(iter.value_) : iter.value_);
+                    memcpy(stream_pos, &value, sizeof ( T));
+                    stream_pos += sizeof ( T);
+                }
+                return stream_pos;
+            }
+
+            template<class NL>
+            static const unsigned char *build(std::vector<proto_crt_t<T>> &items, const unsigned char *stream_pos, NL element_count, int &cb, int big_endian) {
+                if ((uint64_t) cb < (uint64_t) element_count * sizeof ( T)) return nullptr;
+                try {
+                    items.reserve(items.size() + element_count);
+                    for (NL i = 0; i < element_count; i++) {
+                        items.emplace_back();
+                        memcpy(&items.back().value_, stream_pos, sizeof ( T));
+                        if (big_endian) items.back().value_ = proto_element_order<T>::big_endian(items.back().value_);
+                        stream_pos += sizeof ( T);
+                    }
+                } catch (...) {
+                    return nullptr;
+                }
+                cb -= (int) (element_count * sizeof ( T));
+                return stream_pos;
+            }
+        };
+
+        // arithmetic elements are stored contiguously, whole vector copy(or byte swap) in one block.
+        // wire format is the same as vector of proto_crt_t<T>
+        template<class T>
+        struct proto_vector_element<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+
+            static int length(const std::vector<T> &items) {
+                return (int) (items.size() * sizeof ( T));
+            }
+
+            static unsigned char *serialize(const std::vector<T> &items, unsigned char *stream_pos, int big_endian) {
+                if (big_endian) {
+                    toolkit::change_byte_order(stream_pos, items.data(), items.size(), sizeof ( T));
+                } else if (items.size() > 0) {
+                    memcpy(stream_pos, items.data(), items.size() * sizeof ( T));
+                }
+                return stream_pos + items.size() * sizeof ( T);
+            }
+
+            template<class NL>
+            static const unsigned char *build(std::vector<T> &items, const unsigned char *stream_pos, NL element_count, int &cb, int big_endian) {
+                if ((uint64_t) cb < (uint64_t) element_count * sizeof ( T)) return nullptr;
+                std::size_t previous = items.size();
+                try {
+                    items.resize(previous + element_count);
+                } catch (...) {
+                    return nullptr;
+                }
+                if (big_endian) {
+                    toolkit::change_byte_order(items.data() + previous, stream_pos, element_count, sizeof ( T));
+                } else if (element_count > 0) {
+                    memcpy(&items[previous], stream_pos, element_count * sizeof ( T));
+                }
+                cb -= (int) (element_count * sizeof ( T));
+                return stream_pos + element_count * sizeof ( T);
+            }
+        };
+
+        // T can be a type derived from @proto_interface, or arithmetic type(same wire format as proto_crt_t<T>)
+        // with @ENABLE_BIG_ENDIAN, both the count and the arithmetic(or proto_crt_t of arithmetic) elements are in network order
         template<class T, class NL = uint32_t, int ENABLE_BIG_ENDIAN = 0>
         struct proto_vector_t : public std::vector<T>, public proto_interface {
 
@@ -125,10 +251,7 @@ namespace nsp {
             }
 
             virtual const int length() const override {
-                int sum = 0;
-                sum += proto_crt_t<NL>().length();
-                for (const T &iter : * this) sum += iter.length();
-                return sum;
+                return (int) sizeof ( NL) + proto_vector_element<T>::length(*this);
             }
 
             virtual unsigned char *serialize(unsigned char *byte_stream) const override {
@@ -136,11 +259,8 @@ namespace nsp {
                 proto_crt_t<NL> element_count((NL)this->size());
                 if (ENABLE_BIG_ENDIAN) element_count = toolkit::change_byte_order(element_count.value_);
                 stream_pos = element_count.serialize(stream_pos);
-                for (const T &iter : * this) {
-                    stream_pos = iter.serialize(stream_pos);
-                    if (!stream_pos) return nullptr;
-                }
-                return stream_pos;
+                if (!stream_pos) return nullptr;
+                return proto_vector_element<T>::serialize(*this, stream_pos, ENABLE_BIG_ENDIAN);
             }
 
             virtual const unsigned char *build(const unsigned char *byte_stream, int &cb) override {
@@ -150,16 +270,11 @@ namespace nsp {
                 if (ENABLE_BIG_ENDIAN) element_count = toolkit::change_byte_order(element_count.value_);
 				if ( !stream_pos ) return nullptr;
 				if ( !SAFE_VECTOR_SIZE_CHECKING( element_count ) ) return nullptr;
-                for (NL i = 0; i < element_count; i++) {
-                    T item;
-                    stream_pos = item.build(stream_pos, cb);
-                    if (!stream_pos) return nullptr;
-                    this->push_back(std::move(item));
-                }
-                return stream_pos;
+                return proto_vector_element<T>::build(*this, stream_pos, element_count.value_, cb, ENABLE_BIG_ENDIAN);
             }
         };
 
+        // with @ENABLE_BIG_ENDIAN, characters wider than one byte are in network order too
         template<class T, class NL = uint32_t, int ENABLE_BIG_ENDIAN = 0 >
         struct proto_string_t : public std::basic_string<T>, public proto_interface {
 
@@ -187,11 +302,14 @@ namespace nsp {
                 proto_crt_t<NL> element_count(static_cast<NL>( std::basic_string<T>::size()));
                 if (ENABLE_BIG_ENDIAN) element_count = toolkit::change_byte_order(element_count.value_);
                 stream_pos = element_count.serialize(stream_pos);
-                for (const T &iter : *this) {
-                    stream_pos = proto_crt_t<T>(iter).serialize(stream_pos);
-                    if (!stream_pos) return nullptr;
+                if (!stream_pos) return nullptr;
+                int acquire_cb = (int) (std::basic_string<T>::size() * sizeof ( T));
+                if (ENABLE_BIG_ENDIAN && sizeof ( T) > 1) {
+                    toolkit::change_byte_order(stream_pos, this->data(), std::basic_string<T>::size(), sizeof ( T));
+                } else if (acquire_cb > 0) {
+                    memcpy(stream_pos, this->data(), acquire_cb);
                 }
-                return stream_pos;
+                return ( stream_pos + acquire_cb);
             }
 
             virtual const unsigned char *build(const unsigned char *byte_stream, int &cb) override {
@@ -208,6 +326,9 @@ namespace nsp {
                 } catch (...) {
                     return nullptr;
                 }
+                if (ENABLE_BIG_ENDIAN && sizeof ( T) > 1 && element_count > 0) {
+                    toolkit::change_byte_order(&(*this)[0], &(*this)[0], element_count, sizeof ( T));
+                }
                 cb -= acquire_cb;
                 return ( stream_pos + acquire_cb);
             }
@@ -327,6 +448,255 @@ namespace nsp {
 			}
 		};
 
+        // wrap a nested message(derived from @proto_interface), remember it's length until it be modified,
+        // so @length of the outer message(and @psend before serialize) not walk the whole tree again.
+        // only a message encoded more than once(resend, broadcast) or received by @build benefit, a message freshly built by code
+        // is still walked twice on it's first encode: @length then @serialize. see bench/cached_length_bench.cpp
+        // read by @get or operator->, any change must go through @modify which invalidate the cached length
+        template<class T>
+        struct proto_cached_t : public proto_interface {
+
+            proto_cached_t() : value_() {
+                ;
+            }
+
+            proto_cached_t(const T &ref) : value_(ref) {
+                ;
+            }
+
+            proto_cached_t(T &&ref) : value_(std::move(ref)) {
+                ;
+            }
+
+            virtual const int length() const override {
+                if (cached_length_ < 0) {
+                    cached_length_ = value_.length();
+                }
+                return cached_length_;
+            }
+
+            virtual unsigned char *serialize(unsigned char *bytes) const override {
+                return value_.serialize(bytes);
+            }
+
+            // the bytes consumed by build is exactly the length of message
+            virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+                int previous = cb;
+                const unsigned char *stream_pos = value_.build(bytes, cb);
+                cached_length_ = (stream_pos ? (previous - cb) : -1);
+                return stream_pos;
+            }
+
+            const T &get() const {
+                return value_;
+            }
+
+            const T *operator->() const {
+                return &value_;
+            }
+
+            T &modify() {
+                cached_length_ = -1;
+                return value_;
+            }
+
+        private:
+            T value_;
+            mutable int cached_length_ = -1;
+        };
+
+        // view mode counterparts of @proto_string_t/@proto_vector_t/@proto_blob_t(single byte elements only), same wire format.
+        // @build only check the bounds and point into the input bytes, nothing allocated or copied,
+        // so the view is valid only as long as the bytes(the packet in @on_recvdata callback, use @packet_pool::retain to keep it).
+        // elements are read by @at through memcpy, the position in packet is not guaranteed to be aligned.
+        // @serialize writes the referenced bytes unchanged, a received field can be forwarded as it is
+        template<class T, class NL, int ENABLE_BIG_ENDIAN>
+        struct proto_array_view {
+            static_assert(std::is_arithmetic<T>::value, "only array of arithmetic type can be viewed");
+
+            const unsigned char *bytes_ = nullptr;
+            NL count_ = 0;
+
+            const int length() const {
+                return (int) (sizeof ( NL) + count_ * sizeof ( T));
+            }
+
+            unsigned char *serialize(unsigned char *byte_stream) const {
+                if (!byte_stream) return nullptr;
+                NL element_count = (ENABLE_BIG_ENDIAN ? toolkit::change_byte_order(count_) : count_);
+                memcpy(byte_stream, &element_count, sizeof ( NL));
+                if (count_ > 0) {
+                    memcpy(byte_stream + sizeof ( NL), bytes_, count_ * sizeof ( T));
+                }
+                return byte_stream + length();
+            }
+
+            const unsigned char *build(const unsigned char *byte_stream, int &cb, const bool string_checking) {
+                if (!byte_stream || cb < (int) sizeof ( NL)) return nullptr;
+                NL element_count;
+                memcpy(&element_count, byte_stream, sizeof ( NL));
+                if (ENABLE_BIG_ENDIAN) element_count = toolkit::change_byte_order(element_count);
+                if (string_checking ? !SAFE_STRING_SIZE_CHECKING(element_count) : !SAFE_VECTOR_SIZE_CHECKING(element_count)) return nullptr;
+                if ((uint64_t) (cb - sizeof ( NL)) < (uint64_t) element_count * sizeof ( T)) return nullptr;
+                bytes_ = byte_stream + sizeof ( NL);
+                count_ = element_count;
+                cb -= length();
+                return bytes_ + count_ * sizeof ( T);
+            }
+
+            T at(const std::size_t index) const {
+                T value;
+                memcpy(&value, bytes_ + index * sizeof ( T), sizeof ( T));
+                return (ENABLE_BIG_ENDIAN ? proto_element_order<T>::big_endian(value) : value);
+            }
+
+            // copy out @count_ elements into @items in host order
+            void copy(T *items) const {
+                if (ENABLE_BIG_ENDIAN) {
+                    toolkit::change_byte_order(items, bytes_, count_, sizeof ( T));
+                } else if (count_ > 0) {
+                    memcpy(items, bytes_, count_ * sizeof ( T));
+                }
+            }
+        };
+
+        template<class T, class NL = uint32_t, int ENABLE_BIG_ENDIAN = 0 >
+        struct proto_string_view_t : public proto_interface {
+
+            virtual const int length() const override {
+                return array_.length();
+            }
+
+            virtual unsigned char *serialize(unsigned char *bytes) const override {
+                return array_.serialize(bytes);
+            }
+
+            virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+                return array_.build(bytes, cb, true);
+            }
+
+            std::size_t size() const {
+                return array_.count_;
+            }
+
+            bool empty() const {
+                return 0 == array_.count_;
+            }
+
+            T at(const std::size_t index) const {
+                return array_.at(index);
+            }
+
+            // characters of single byte can be compared or printed directly, not null terminated
+            const unsigned char *data() const {
+                return array_.bytes_;
+            }
+
+            std::basic_string<T> str() const {
+                std::basic_string<T> copied(array_.count_, T());
+                if (array_.count_ > 0) {
+                    array_.copy(&copied[0]);
+                }
+                return copied;
+            }
+
+        private:
+            proto_array_view<T, NL, ENABLE_BIG_ENDIAN> array_;
+        };
+
+        // T must be arithmetic, the wire format is the same as proto_vector_t<T>(or proto_vector_t<proto_crt_t<T>>)
+        template<class T, class NL = uint32_t, int ENABLE_BIG_ENDIAN = 0 >
+        struct proto_vector_view_t : public proto_interface {
+
+            virtual const int length() const override {
+                return array_.length();
+            }
+
+            virtual unsigned char *serialize(unsigned char *bytes) const override {
+                return array_.serialize(bytes);
+            }
+
+            virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+                return array_.build(bytes, cb, false);
+            }
+
+            std::size_t size() const {
+                return array_.count_;
+            }
+
+            bool empty() const {
+                return 0 == array_.count_;
+            }
+
+            T at(const std::size_t index) const {
+                return array_.at(index);
+            }
+
+            T operator[](const std::size_t index) const {
+                return array_.at(index);
+            }
+
+            const unsigned char *data() const {
+                return array_.bytes_;
+            }
+
+            std::vector<T> vector() const {
+                std::vector<T> copied(array_.count_);
+                if (array_.count_ > 0) {
+                    array_.copy(copied.data());
+                }
+                return copied;
+            }
+
+        private:
+            proto_array_view<T, NL, ENABLE_BIG_ENDIAN> array_;
+        };
+
+        // like @proto_blob_t, the element count is known by both sides and not on the wire.
+        // @proto_blob_t moves @count_ bytes whatever the size of T, so only single byte T keep the same wire format
+        template<class T>
+        struct proto_blob_view_t : public proto_interface {
+            static_assert(sizeof ( T) == 1, "only blob of single byte type can be viewed, same bytes as proto_blob_t on the wire");
+
+            const unsigned char *bytes_ = nullptr;
+            int count_ = 0;
+
+            proto_blob_view_t(int count) {
+                count_ = ((count > 0) ? count : 0);
+            }
+
+            virtual const int length() const override {
+                return count_ * sizeof ( T);
+            }
+
+            virtual unsigned char *serialize(unsigned char *bytes) const override {
+                if (bytes && bytes_ && count_ > 0) {
+                    memcpy(bytes, bytes_, length());
+                    return bytes + length();
+                }
+                return nullptr;
+            }
+
+            virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+                if (bytes && cb >= length() && count_ > 0) {
+                    bytes_ = bytes;
+                    cb -= length();
+                    return bytes + length();
+                }
+                return nullptr;
+            }
+
+            T at(const int index) const {
+                T value;
+                memcpy(&value, bytes_ + index * sizeof ( T), sizeof ( T));
+                return value;
+            }
+
+            const unsigned char *data() const {
+                return bytes_;
+            }
+        };
+
 #if 0
         template<class T, uint32_t N, template <class> class proto_container = proto_crt_t>
         struct proto_array_t : public proto_interface {
@@ -0,0 +1,342 @@
+﻿#if !defined TCPIP_PROTO_STATIC_SERIALIZE_HEADER
+#define TCPIP_PROTO_STATIC_SERIALIZE_HEADER
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+
+#include "serialize.hpp"
+
+/*
+ *  compile-time serialization, the non-virtual counterpart of @proto_interface
+ *
+ *  a message is a plain struct which list it's fields in wire order by @STATIC_PROTO_FIELDS, after all of them are declared:
+ *
+ *      struct login_request {
+ *          uint32_t id_;
+ *          std::string name_;
+ *          std::vector<float> scores_;
+ *          STATIC_PROTO_FIELDS(id_, name_, scores_)
+ *      };
+ *
+ *  the encode/decode of every field is resolved at compile time and inlined, no vtable pointer is stored in the fields.
+ *  the wire format is the same as the @proto_interface family with default template arguments:
+ *      arithmetic and enum   : raw bytes in host order, same as proto_crt_t<T>
+ *      std::basic_string<C>  : uint32_t count followed by the characters, same as proto_string_t<C>
+ *      std::vector<T>        : uint32_t count followed by the elements, same as proto_vector_t<proto_crt_t<T>>
+ *      nested message        : the fields of the nested message in order
+ *      proto_interface object: encoded by it's virtual methods, so existing field types can be mixed in
+ *  so both sides of a link can migrate independently.
+ *  use @proto_static_t<M> where a @proto_interface is required, or send the message by @psend directly.
+ */
+
+#define STATIC_PROTO_FIELDS(...) \
+    auto static_fields() -> decltype(std::tie(__VA_ARGS__)) { return std::tie(__VA_ARGS__); } \
+    auto static_fields() const -> decltype(std::tie(__VA_ARGS__)) { return std::tie(__VA_ARGS__); }
+
+namespace nsp {
+    namespace proto {
+
+        enum static_field_kind {
+            kStaticFieldPod = 0,
+            kStaticFieldString,
+            kStaticFieldVector,
+            kStaticFieldMessage,
+            kStaticFieldInterface,
+            kStaticFieldUnsupported,
+        };
+
+        template<class T>
+        struct has_static_fields {
+        private:
+            template<class U> static char test(typename std::remove_reference<decltype(std::declval<const U &>().static_fields())>::type *);
+            template<class U> static int test(...);
+        public:
+            static const bool value = (sizeof (test<T>(nullptr)) == sizeof (char));
+        };
+
+        template<class T>
+        struct static_field_kind_of {
+            static const int value = (std::is_base_of<proto_interface, T>::value ? kStaticFieldInterface :
+                    (has_static_fields<T>::value ? kStaticFieldMessage :
+                    ((std::is_arithmetic<T>::value || std::is_enum<T>::value) ? kStaticFieldPod : kStaticFieldUnsupported)));
+        };
+
+        template<class C, class Traits, class Alloc>
+        struct static_field_kind_of<std::basic_string<C, Traits, Alloc>> {
+            static const int value = kStaticFieldString;
+        };
+
+        template<class T, class Alloc>
+        struct static_field_kind_of<std::vector<T, Alloc>> {
+            static const int value = kStaticFieldVector;
+        };
+
+        template<class T, int K = static_field_kind_of<T>::value>
+        struct static_codec {
+            static_assert(K != kStaticFieldUnsupported, "field type is not supported by static serialization");
+        };
+
+        template<class T>
+        struct static_codec<T, kStaticFieldPod> {
+            static int length(const T &) {
+                return sizeof (T);
+            }
+
+            static unsigned char *serialize(const T &value, unsigned char *bytes) {
+                memcpy(bytes, &value, sizeof (T));
+                return bytes + sizeof (T);
+            }
+
+            static const unsigned char *build(T &value, const unsigned char *bytes, int &cb) {
+                if (cb < (int) sizeof (T)) return nullptr;
+                memcpy(&value, bytes, sizeof (T));
+                cb -= sizeof (T);
+                return bytes + sizeof (T);
+            }
+        };
+
+        template<class S>
+        struct static_codec<S, kStaticFieldString> {
+            typedef typename S::value_type C;
+
+            static int length(const S &str) {
+                return (int) (sizeof (uint32_t) + str.size() * sizeof (C));
+            }
+
+            static unsigned char *serialize(const S &str, unsigned char *bytes) {
+                bytes = static_codec<uint32_t>::serialize((uint32_t) str.size(), bytes);
+                if (str.size() > 0) {
+                    memcpy(bytes, str.data(), str.size() * sizeof (C));
+                }
+                return bytes + str.size() * sizeof (C);
+            }
+
+            static const unsigned char *build(S &str, const unsigned char *bytes, int &cb) {
+                uint32_t count;
+                bytes = static_codec<uint32_t>::build(count, bytes, cb);
+                if (!bytes || !SAFE_STRING_SIZE_CHECKING(count)) return nullptr;
+                if ((uint64_t) cb < (uint64_t) count * sizeof (C)) return nullptr;
+                try {
+                    str.assign((const C *) bytes, count);
+                } catch (...) {
+                    return nullptr;
+                }
+                cb -= (int) (count * sizeof (C));
+                return bytes + count * sizeof (C);
+            }
+        };
+
+        template<class V>
+        struct static_codec<V, kStaticFieldVector> {
+            typedef typename V::value_type E;
+            typedef static_codec<E> element_codec;
+            // elements copied as one block, the layout is exactly the sequence of each element.
+            // the path is selected at compile time, so memcpy is never instantiated for other element types.
+            // std::vector<bool> is packed and has no data(), it is encoded element by element
+            typedef std::integral_constant<bool, (static_field_kind_of<E>::value == kStaticFieldPod && !std::is_same<E, bool>::value)> block_tag;
+            // elements of std::vector<bool> are proxies, they can not be built in place
+            typedef std::integral_constant<bool, std::is_same<E, bool>::value> proxy_tag;
+
+            static int length(const V &vec) {
+                return length(vec, block_tag());
+            }
+
+            static unsigned char *serialize(const V &vec, unsigned char *bytes) {
+                bytes = static_codec<uint32_t>::serialize((uint32_t) vec.size(), bytes);
+                return serialize(vec, bytes, block_tag());
+            }
+
+            static const unsigned char *build(V &vec, const unsigned char *bytes, int &cb) {
+                uint32_t count;
+                bytes = static_codec<uint32_t>::build(count, bytes, cb);
+                if (!bytes || !SAFE_VECTOR_SIZE_CHECKING(count)) return nullptr;
+                try {
+                    return build(vec, count, bytes, cb, block_tag());
+                } catch (...) {
+                    return nullptr;
+                }
+            }
+
+        private:
+            static int length(const V &vec, std::true_type) {
+                return (int) (sizeof (uint32_t) + vec.size() * sizeof (E));
+            }
+
+            static int length(const V &vec, std::false_type) {
+                int sum = sizeof (uint32_t);
+                for (const E &item : vec) sum += element_codec::length(item);
+                return sum;
+            }
+
+            static unsigned char *serialize(const V &vec, unsigned char *bytes, std::true_type) {
+                if (vec.size() > 0) {
+                    memcpy(bytes, vec.data(), vec.size() * sizeof (E));
+                }
+                return bytes + vec.size() * sizeof (E);
+            }
+
+            static unsigned char *serialize(const V &vec, unsigned char *bytes, std::false_type) {
+                for (const E &item : vec) {
+                    bytes = element_codec::serialize(item, bytes);
+                    if (!bytes) return nullptr;
+                }
+                return bytes;
+            }
+
+            static const unsigned char *build(V &vec, const uint32_t count, const unsigned char *bytes, int &cb, std::true_type) {
+                if ((uint64_t) cb < (uint64_t) count * sizeof (E)) return nullptr;
+                vec.resize(count);
+                if (count > 0) {
+                    memcpy(vec.data(), bytes, count * sizeof (E));
+                }
+                cb -= (int) (count * sizeof (E));
+                return bytes + count * sizeof (E);
+            }
+
+            static const unsigned char *build(V &vec, const uint32_t count, const unsigned char *bytes, int &cb, std::false_type) {
+                vec.clear();
+                for (uint32_t i = 0; i < count && bytes; i++) {
+                    bytes = append(vec, bytes, cb, proxy_tag());
+                }
+                return bytes;
+            }
+
+            static const unsigned char *append(V &vec, const unsigned char *bytes, int &cb, std::false_type) {
+                vec.emplace_back();
+                return element_codec::build(vec.back(), bytes, cb);
+            }
+
+            static const unsigned char *append(V &vec, const unsigned char *bytes, int &cb, std::true_type) {
+                E item = E();
+                bytes = element_codec::build(item, bytes, cb);
+                if (bytes) vec.push_back(item);
+                return bytes;
+            }
+        };
+
+        template<class T>
+        struct static_codec<T, kStaticFieldInterface> {
+            static int length(const T &value) {
+                return value.length();
+            }
+
+            static unsigned char *serialize(const T &value, unsigned char *bytes) {
+                return value.serialize(bytes);
+            }
+
+            static const unsigned char *build(T &value, const unsigned char *bytes, int &cb) {
+                return value.build(bytes, cb);
+            }
+        };
+
+        // walk the tuple of field references returned by @static_fields
+        template<std::size_t I, std::size_t N>
+        struct static_fields_codec {
+            template<class Tuple>
+            using field = typename std::decay<typename std::tuple_element<I, Tuple>::type>::type;
+
+            template<class Tuple>
+            static int length(const Tuple &fields) {
+                return static_codec<field<Tuple>>::length(std::get<I>(fields)) + static_fields_codec<I + 1, N>::length(fields);
+            }
+
+            template<class Tuple>
+            static unsigned char *serialize(const Tuple &fields, unsigned char *bytes) {
+                bytes = static_codec<field<Tuple>>::serialize(std::get<I>(fields), bytes);
+                return (bytes ? static_fields_codec<I + 1, N>::serialize(fields, bytes) : nullptr);
+            }
+
+            template<class Tuple>
+            static const unsigned char *build(Tuple &fields, const unsigned char *bytes, int &cb) {
+                bytes = static_codec<field<Tuple>>::build(std::get<I>(fields), bytes, cb);
+                return (bytes ? static_fields_codec<I + 1, N>::build(fields, bytes, cb) : nullptr);
+            }
+        };
+
+        template<std::size_t N>
+        struct static_fields_codec<N, N> {
+            template<class Tuple>
+            static int length(const Tuple &) {
+                return 0;
+            }
+
+            template<class Tuple>
+            static unsigned char *serialize(const Tuple &, unsigned char *bytes) {
+                return bytes;
+            }
+
+            template<class Tuple>
+            static const unsigned char *build(Tuple &, const unsigned char *bytes, int &) {
+                return bytes;
+            }
+        };
+
+        template<class M>
+        struct static_codec<M, kStaticFieldMessage> {
+            typedef decltype(std::declval<M &>().static_fields()) fields_type;
+            typedef static_fields_codec<0, std::tuple_size<fields_type>::value> fields_codec;
+
+            static int length(const M &msg) {
+                return fields_codec::length(msg.static_fields());
+            }
+
+            static unsigned char *serialize(const M &msg, unsigned char *bytes) {
+                return fields_codec::serialize(msg.static_fields(), bytes);
+            }
+
+            static const unsigned char *build(M &msg, const unsigned char *bytes, int &cb) {
+                fields_type fields = msg.static_fields();
+                return fields_codec::build(fields, bytes, cb);
+            }
+        };
+
+        // entries for messages declared by @STATIC_PROTO_FIELDS, same contract as the methods of @proto_interface
+        template<class M>
+        inline int static_length(const M &msg) {
+            return static_codec<M>::length(msg);
+        }
+
+        template<class M>
+        inline unsigned char *static_serialize(const M &msg, unsigned char *bytes) {
+            return (bytes ? static_codec<M>::serialize(msg, bytes) : nullptr);
+        }
+
+        template<class M>
+        inline const unsigned char *static_build(M &msg, const unsigned char *bytes, int &cb) {
+            return (bytes ? static_codec<M>::build(msg, bytes, cb) : nullptr);
+        }
+
+        // adapter to @proto_interface, only one virtual call for the whole message
+        template<class M>
+        struct proto_static_t : public M, public proto_interface {
+
+            proto_static_t() : M() {
+                ;
+            }
+
+            proto_static_t(const M &msg) : M(msg) {
+                ;
+            }
+
+            virtual const int length() const override {
+                return static_length<M>(*this);
+            }
+
+            virtual unsigned char *serialize(unsigned char *bytes) const override {
+                return static_serialize<M>(*this, bytes);
+            }
+
+            virtual const unsigned char *build(const unsigned char *bytes, int &cb) override {
+                return static_build<M>(*this, bytes, cb);
+            }
+        };
+
+    } // namespace proto
+} // namespace nsp
+
+#endif // !TCPIP_PROTO_STATIC_SERIALIZE_HEADER
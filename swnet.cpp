@@ -1,4 +1,7 @@
 #include <exception>
+#include <mutex>
+#include <vector>
+#include <algorithm>
 
 #include "swnet.h"
 #include "os_util.hpp"
@@ -8,11 +11,132 @@
 namespace nsp {
     namespace tcpip {
 
+        template<class F>
+        void swnet::tcp_refobj(const HTCPLINK lnk, F &&todo) {
+            if (INVALID_HTCPLINK != lnk) {
+                std::shared_ptr<obtcp> object;
+                if (tcp_search(lnk, object) >= 0) {
+                    todo(object);
+                }
+            }
+        }
+
+        template<class F>
+        void swnet::udp_refobj(const HUDPLINK lnk, F &&todo) {
+            if (INVALID_HUDPLINK != lnk) {
+                std::shared_ptr<obudp> object;
+                if (udp_search(lnk, object) >= 0) {
+                    todo(object);
+                }
+            }
+        }
+
+        ///////////////////////////////////////		dispatch latency ///////////////////////////////////////
+        static const int kDispatchEvents = 6;
+
+        // histograms of the handler time of each event, owned by one dispatch thread
+        struct dispatch_histograms {
+            latency_histogram tcp_[kDispatchEvents];
+            latency_histogram udp_[kDispatchEvents];
+        };
+
+        static std::mutex dispatch_registry_lock;
+        static std::vector<dispatch_histograms *> dispatch_registry;
+        // counts of exited threads
+        static std::vector<uint64_t> retired_counts[2][kDispatchEvents];
+        static uint64_t retired_max[2][kDispatchEvents];
+
+        struct local_histograms_holder {
+            dispatch_histograms *histograms_ = nullptr;
+
+            dispatch_histograms *get() {
+                if (!histograms_) {
+                    histograms_ = new dispatch_histograms;
+                    std::lock_guard < decltype(dispatch_registry_lock) > guard(dispatch_registry_lock);
+                    dispatch_registry.push_back(histograms_);
+                }
+                return histograms_;
+            }
+
+            ~local_histograms_holder() {
+                if (histograms_) {
+                    std::lock_guard < decltype(dispatch_registry_lock) > guard(dispatch_registry_lock);
+                    for (int i = 0; i < kDispatchEvents; i++) {
+                        histograms_->tcp_[i].merge(retired_counts[0][i], retired_max[0][i]);
+                        histograms_->udp_[i].merge(retired_counts[1][i], retired_max[1][i]);
+                    }
+                    auto iter = std::find(dispatch_registry.begin(), dispatch_registry.end(), histograms_);
+                    if (dispatch_registry.end() != iter) {
+                        dispatch_registry.erase(iter);
+                    }
+                    delete histograms_;
+                    histograms_ = nullptr;
+                }
+            }
+        };
+
+        static thread_local local_histograms_holder local_histograms;
+
+        static int dispatch_index(const int event) {
+            switch (event) {
+                case EVT_RECEIVEDATA:
+                    return 0;
+                case EVT_TCP_ACCEPTED:
+                    return 1;
+                case EVT_TCP_CONNECTED:
+                    return 2;
+                case EVT_PRE_CLOSE:
+                    return 3;
+                case EVT_CLOSED:
+                    return 4;
+                case EVT_PIPEDATA:
+                    return 5;
+                default:
+                    return -1;
+            }
+        }
+
+        static int dispatch_latency(const int proto, const int event, latency_stat &stat) {
+            int index = dispatch_index(event);
+            if (index < 0) {
+                return -1;
+            }
+
+            std::vector<uint64_t> counts;
+            uint64_t max = 0;
+            {
+                std::lock_guard < decltype(dispatch_registry_lock) > guard(dispatch_registry_lock);
+                counts = retired_counts[proto][index];
+                max = retired_max[proto][index];
+                for (dispatch_histograms *histograms : dispatch_registry) {
+                    (0 == proto ? histograms->tcp_ : histograms->udp_)[index].merge(counts, max);
+                }
+            }
+            latency_histogram::percentile(counts, max, stat);
+            return 0;
+        }
+
+        std::atomic<int> swnet::latency_{0};
+
         void STD_CALL swnet::tcp_io(const nis_event_t *tcp_evt, const void *data) {
             if (!tcp_evt) {
                 return;
             }
 
+            if (0 == latency_.load(std::memory_order_relaxed)) {
+                tcp_dispatch(tcp_evt, data);
+                return;
+            }
+
+            int index = dispatch_index(tcp_evt->Event);
+            uint64_t begin = os::clock_gettime();
+            tcp_dispatch(tcp_evt, data);
+            if (index >= 0) {
+                local_histograms.get()->tcp_[index].record(os::clock_gettime() - begin);
+            }
+        }
+
+        void swnet::tcp_dispatch(const nis_event_t *tcp_evt, const void *data) {
             switch (tcp_evt->Event) {
                 case EVT_RECEIVEDATA:
                     toolkit::singleton<swnet>::instance()->tcp_refobj(tcp_evt->Ln.Tcp.Link, [&] (const std::shared_ptr<obtcp> &object) {
@@ -40,6 +164,11 @@ namespace nsp {
                         object->on_closed();
                     });
                     break;
+                case EVT_PIPEDATA:
+                    toolkit::singleton<swnet>::instance()->tcp_refobj(tcp_evt->Ln.Tcp.Link, [&](const std::shared_ptr<obtcp> &object) {
+                        object->on_pipedata();
+                    });
+                    break;
                 default:
                     break;
             }
@@ -50,6 +179,20 @@ namespace nsp {
                 return;
             }
 
+            if (0 == latency_.load(std::memory_order_relaxed)) {
+                udp_dispatch(udp_evt, data);
+                return;
+            }
+
+            int index = dispatch_index(udp_evt->Event);
+            uint64_t begin = os::clock_gettime();
+            udp_dispatch(udp_evt, data);
+            if (index >= 0) {
+                local_histograms.get()->udp_[index].record(os::clock_gettime() - begin);
+            }
+        }
+
+        void swnet::udp_dispatch(const nis_event_t *udp_evt, const void *data) {
             switch (udp_evt->Event) {
                 case EVT_RECEIVEDATA:
                     toolkit::singleton<swnet>::instance()->udp_refobj(udp_evt->Ln.Udp.Link, [&] (const std::shared_ptr<obudp> &object) {
@@ -81,10 +224,22 @@ namespace nsp {
             }
         }
 
-        swnet::swnet() {
+        std::atomic<int> swnet::shards_{link_table<std::shared_ptr<obtcp>>::kDefaultShards};
+        std::atomic<int> swnet::constructed_{0};
+
+        swnet::swnet() : tcp_object_(shards_.load()), udp_object_(shards_.load()) {
+            constructed_ = 1;
             nis_checr(&swnet::ecr);
         }
 
+        int swnet::setshards(int shards) {
+            if (shards <= 0 || constructed_ > 0) {
+                return -1;
+            }
+            shards_ = shards;
+            return 0;
+        }
+
         swnet::~swnet() {
             ;
         }
@@ -100,41 +255,38 @@ namespace nsp {
         }
 
         int swnet::tcp_attach(HTCPLINK lnk, const std::shared_ptr<obtcp> &object) {
-            std::lock_guard < decltype(lock_tcp_redirection_) > guard(lock_tcp_redirection_);
-            // std::pair<std::unorderd_map<HTCPLINK, std::shared_ptr<obtcp>>::iterator, bool>
-            auto insr = tcp_object_.insert(std::pair<HTCPLINK, std::shared_ptr<obtcp>>(lnk,object));
-            if (insr.second) {
-                return 0;
-            }
-            return -1;
+            return (tcp_object_.insert(lnk, object) ? 0 : -1);
         }
 
         void swnet::tcp_detach(HTCPLINK lnk) {
-            std::lock_guard < decltype(lock_tcp_redirection_) > guard(lock_tcp_redirection_);
-            auto iter = tcp_object_.find(lnk);
-            if (tcp_object_.end() != iter) {
-                tcp_object_.erase(iter);
-            }
+            tcp_object_.erase(lnk);
         }
 
-        int swnet::tcp_search(const HTCPLINK lnk, std::shared_ptr<obtcp> &object) const {
-            std::lock_guard < decltype(lock_tcp_redirection_) > guard(lock_tcp_redirection_);
-            auto iter = tcp_object_.find(lnk);
-            if (tcp_object_.end() != iter) {
-                object = iter->second;
-                return 0;
-            }
-            return -1;
+        void swnet::tcp_shards(std::vector<link_shard_stat> &shard_stat) const {
+            tcp_object_.stat(shard_stat);
         }
 
-        void swnet::tcp_refobj(const HTCPLINK lnk, const std::function<void( const std::shared_ptr<obtcp>)> &todo) {
-            if (INVALID_HTCPLINK != lnk && todo) {
-                std::shared_ptr<obtcp> object;
-                if (tcp_search(lnk, object) >= 0) {
-                    todo(object);
-                }
-            }
+        void swnet::setlatency(int enable) {
+            latency_ = ((enable > 0) ? 1 : 0);
         }
+
+        int swnet::tcp_latency(const int event, latency_stat &stat) const {
+            return dispatch_latency(0, event, stat);
+        }
+
+        void swnet::tcp_counters(std::vector<std::pair<HTCPLINK, link_counter>> &counters) const {
+            counters.clear();
+            tcp_object_.for_each([&](const HTCPLINK lnk, const std::shared_ptr<obtcp> &object) {
+                link_counter lnk_counter;
+                object->counter(lnk_counter);
+                counters.push_back(std::make_pair(lnk, lnk_counter));
+            });
+        }
+
+        int swnet::tcp_search(const HTCPLINK lnk, std::shared_ptr<obtcp> &object) const {
+            return (tcp_object_.search(lnk, object) ? 0 : -1);
+        }
+
         ///////////////////////////////////////////////////////////   UDP /////////////////////////////////////////////////////////////
 
         int swnet::udp_create(const std::shared_ptr<obudp> &object, const char* ipstr, const port_t port, int flag) {
@@ -144,41 +296,32 @@ namespace nsp {
             }
 
             object->setlnk(lnk);
-
-            std::lock_guard < decltype(this->lock_udp_redirection_) > guard(lock_udp_redirection_);
-            // std::pair<std::unorderd_map<HUDPLINK, std::shared_ptr<obudp>>::iterator, bool>
-            auto insr = udp_object_.insert(std::pair<HUDPLINK, std::shared_ptr<obudp>>(lnk,object));
-            if (insr.second) {
-                return 0;
-            }
-            return -1;
+            return (udp_object_.insert(lnk, object) ? 0 : -1);
         }
 
         void swnet::udp_detach(HUDPLINK lnk) {
-            std::lock_guard < decltype(lock_udp_redirection_) > guard(lock_udp_redirection_);
-            auto iter = udp_object_.find(lnk);
-            if (udp_object_.end() != iter) {
-                udp_object_.erase(iter);
-            }
+            udp_object_.erase(lnk);
         }
 
-        int swnet::udp_search(const HUDPLINK lnk, std::shared_ptr<obudp> &object) const {
-            std::lock_guard < decltype(lock_udp_redirection_) > guard(lock_udp_redirection_);
-            auto iter = udp_object_.find(lnk);
-            if (udp_object_.end() != iter) {
-                object = iter->second;
-                return 0;
-            }
-            return -1;
+        void swnet::udp_shards(std::vector<link_shard_stat> &shard_stat) const {
+            udp_object_.stat(shard_stat);
         }
 
-        void swnet::udp_refobj(const HUDPLINK lnk, const std::function<void( const std::shared_ptr<obudp>)> &todo) {
-            if (INVALID_HUDPLINK != lnk && todo) {
-                std::shared_ptr<obudp> object;
-                if (udp_search(lnk, object) >= 0) {
-                    todo(object);
-                }
-            }
+        int swnet::udp_latency(const int event, latency_stat &stat) const {
+            return dispatch_latency(1, event, stat);
+        }
+
+        void swnet::udp_counters(std::vector<std::pair<HUDPLINK, link_counter>> &counters) const {
+            counters.clear();
+            udp_object_.for_each([&](const HUDPLINK lnk, const std::shared_ptr<obudp> &object) {
+                link_counter lnk_counter;
+                object->counter(lnk_counter);
+                counters.push_back(std::make_pair(lnk, lnk_counter));
+            });
+        }
+
+        int swnet::udp_search(const HUDPLINK lnk, std::shared_ptr<obudp> &object) const {
+            return (udp_object_.search(lnk, object) ? 0 : -1);
         }
 
     }
@@ -2,8 +2,8 @@
 #define SWNET_INTERFACE_CALL
 
 #include <memory>
-#include <unordered_map>
-#include <mutex>
+#include <atomic>
+#include <vector>
 
 #include "icom/nisdef.h"
 #include "icom/nis.h"
@@ -11,6 +11,8 @@
 #include "singleton.hpp"
 #include "network_handler.h"
 #include "os_util.hpp"
+#include "link_table.hpp"
+#include "latency_histogram.h"
 
 namespace nsp {
     namespace tcpip {
@@ -20,38 +22,60 @@ namespace nsp {
             // void *shared_library_ = nullptr;
 
             // TCP
-            mutable std::recursive_mutex lock_tcp_redirection_;
-            std::unordered_map<HTCPLINK, std::shared_ptr<obtcp>> tcp_object_;
+            link_table<std::shared_ptr<obtcp>> tcp_object_;
 
             int tcp_search(const HTCPLINK lnk, std::shared_ptr<obtcp> &object) const;
-            void tcp_refobj(const HTCPLINK lnk, const std::function<void( const std::shared_ptr<obtcp>)> &todo);
+            // the callback(@todo) is invoked directly(no type erasure) with the object pinned by the lookup, only one reference count is taken
+            template<class F>
+            void tcp_refobj(const HTCPLINK lnk, F &&todo);
 
             // UDP
-            mutable std::recursive_mutex lock_udp_redirection_;
-            std::unordered_map<HUDPLINK, std::shared_ptr<obudp>> udp_object_;
+            link_table<std::shared_ptr<obudp>> udp_object_;
 
             int udp_search(const HUDPLINK lnk, std::shared_ptr<obudp> &object) const;
-            void udp_refobj(const HUDPLINK lnk, const std::function<void( const std::shared_ptr<obudp>)> &todo);
+            template<class F>
+            void udp_refobj(const HUDPLINK lnk, F &&todo);
 
             // c-d
             friend class nsp::toolkit::singleton<swnet>;
             swnet();
             ~swnet();
 
+            static std::atomic<int> shards_;
+            static std::atomic<int> constructed_;
+            static std::atomic<int> latency_;
+
             //io
             static void STD_CALL tcp_io(const nis_event_t *pParam1, const void *pParam2);
             static void STD_CALL udp_io(const nis_event_t *pParam1, const void *pParam2);
             static void STD_CALL ecr(const char *host_event, const char *reserved, int rescb);
+            static void tcp_dispatch(const nis_event_t *tcp_evt, const void *data);
+            static void udp_dispatch(const nis_event_t *udp_evt, const void *data);
             
         public:
+            // the shard count of link tables, must be set before the first reference of swnet singleton.
+            // round up to power of two, return -1 if the singleton has already been constructed
+            static int setshards(int shards);
+            // time every event handler into per-thread histograms(100ns units), disabled by default
+            static void setlatency(int enable);
+
             // TCP
             int tcp_create(const std::shared_ptr<obtcp> &object, const char *ipstr, const port_t port);
             int tcp_attach(HTCPLINK lnk, const std::shared_ptr<obtcp> &object);
             void tcp_detach(HTCPLINK lnk);
+            void tcp_shards(std::vector<link_shard_stat> &shard_stat) const;
+            // snapshot the counters of every attached link
+            void tcp_counters(std::vector<std::pair<HTCPLINK, link_counter>> &counters) const;
+            // handler time of @event(EVT_RECEIVEDATA/EVT_TCP_ACCEPTED/EVT_TCP_CONNECTED/EVT_PRE_CLOSE/EVT_CLOSED/EVT_PIPEDATA)
+            // merged over all dispatch threads, return -1 if @event is not instrumented
+            int tcp_latency(const int event, latency_stat &stat) const;
 
             // UDP
             int udp_create(const std::shared_ptr<obudp> &object, const char* ipstr, const port_t port, int flag = UDP_FLAG_NONE);
             void udp_detach(HUDPLINK lnk);
+            void udp_shards(std::vector<link_shard_stat> &shard_stat) const;
+            void udp_counters(std::vector<std::pair<HUDPLINK, link_counter>> &counters) const;
+            int udp_latency(const int event, latency_stat &stat) const;
         };
     }
 }
@@ -64,6 +64,17 @@ namespace nsp {
                 cv_.notify_one();
             }
 
+            // 队列中尚未执行的任务数量
+            std::size_t size() {
+                std::unique_lock < decltype(task_locker_) > guard(task_locker_);
+                return task_que_.size();
+            }
+
+            // 工作线程的原生句柄, 可用于设置CPU亲和性
+            std::thread::native_handle_type native_handle() {
+                return th_.native_handle();
+            }
+
             void join() {
                 {
                     std::unique_lock < decltype(task_locker_) > guard(task_locker_);
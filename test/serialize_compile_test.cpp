@@ -0,0 +1,62 @@
+﻿/*
+ *  element types without a fixed width byte swap(long double) must still compile in @proto_vector_t,
+ *  with or without @ENABLE_BIG_ENDIAN, and keep host order as they did before the block paths
+ *
+ *  build:  g++ -std=c++11 -O2 -DSTD_CALL= -I.. serialize_compile_test.cpp ../byteorder.cpp -o serialize_compile_test
+ *  usage:  ./serialize_compile_test
+ */
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "serialize.hpp"
+
+using namespace nsp::proto;
+
+template<class V>
+static int round_trip(const char *name) {
+    V origin;
+    for (int i = 0; i < 5; i++) {
+        origin.push_back((long double) i / 3);
+    }
+
+    std::vector<unsigned char> bytes(origin.length());
+    if (origin.serialize(bytes.data()) != bytes.data() + bytes.size()) {
+        printf("%s: serialize failed\n", name);
+        return 1;
+    }
+
+    // after the count, the elements are the host order bytes of each value(the padding bytes of long double are not compared)
+    for (std::size_t i = 0; i < origin.size(); i++) {
+        long double value;
+        memcpy(&value, bytes.data() + sizeof ( uint32_t) + i * sizeof ( long double), sizeof ( long double));
+        if (value != (long double) origin[i]) {
+            printf("%s: element %d is not in host order\n", name, (int) i);
+            return 1;
+        }
+    }
+
+    V restore;
+    int cb = (int) bytes.size();
+    if (!restore.build(bytes.data(), cb) || 0 != cb || restore.size() != origin.size()) {
+        printf("%s: build failed\n", name);
+        return 1;
+    }
+    for (std::size_t i = 0; i < origin.size(); i++) {
+        if ((long double) restore[i] != (long double) origin[i]) {
+            printf("%s: element %d differ\n", name, (int) i);
+            return 1;
+        }
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int failures = 0;
+    failures += round_trip<proto_vector_t<proto_crt_t<long double>>>("proto_vector_t<proto_crt_t<long double>>");
+    failures += round_trip<proto_vector_t<proto_crt_t<long double>, uint32_t, 1>>("proto_vector_t<proto_crt_t<long double>, uint32_t, 1>");
+    failures += round_trip<proto_vector_t<long double>>("proto_vector_t<long double>");
+    failures += round_trip<proto_vector_t<long double, uint32_t, 1>>("proto_vector_t<long double, uint32_t, 1>");
+    return failures;
+}
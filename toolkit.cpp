@@ -235,22 +235,6 @@ namespace nsp {
             return std::string().assign(tmp);
         }
 
-        uint32_t htonl(const uint32_t l) {
-            return change_byte_order<uint32_t>(l);
-        }
-
-        unsigned short htons(const uint16_t s) {
-            return change_byte_order<unsigned short>(s);
-        }
-
-        uint32_t ntohl(const uint32_t l) {
-            return htonl(l);
-        }
-
-        unsigned short ntohs(const uint16_t s) {
-            return htons(s);
-        }
-
         // greatest common divisor
 
         int gcd(int a, int b) {
@@ -6,6 +6,12 @@
 
 #include <vector>
 #include <string>
+#include <cstring>
+#include <cstdint>
+
+#if _WIN32
+#include <stdlib.h>
+#endif
 
 namespace nsp {
     namespace toolkit {
@@ -70,22 +76,89 @@ namespace nsp {
         template<class T>
         std::basic_string<T> strformat(int cch, const T *format, ...);
 
-        // 字节序转换例程
+        // 字节序转换例程, 按类型宽度使用编译器的字节交换指令
 
-        template<class T>
-        T change_byte_order(const T &t) {
-            T dst = 0;
-            for (unsigned int i = 0; i < sizeof ( T); i++) {
-                // dst = (dst | (t >> (i * BITS_P_BYTE)) & 0xFF) << ((i < (sizeof ( T) - 1) ? BITS_P_BYTE : 0));
-                dst |= ((t >> (i * BITS_P_BYTE)) & 0xFF);
-                dst <<= ((i) < (sizeof ( T) - 1) ? BITS_P_BYTE : (0));
+        template<std::size_t N>
+        struct byte_order_swapper;
+
+        template<>
+        struct byte_order_swapper<1> {
+            typedef uint8_t type;
+
+            static type swap(const type v) {
+                return v;
+            }
+        };
+
+        template<>
+        struct byte_order_swapper<2> {
+            typedef uint16_t type;
+
+            static type swap(const type v) {
+#if _WIN32
+                return _byteswap_ushort(v);
+#else
+                return __builtin_bswap16(v);
+#endif
+            }
+        };
+
+        template<>
+        struct byte_order_swapper<4> {
+            typedef uint32_t type;
+
+            static type swap(const type v) {
+#if _WIN32
+                return _byteswap_ulong(v);
+#else
+                return __builtin_bswap32(v);
+#endif
+            }
+        };
+
+        template<>
+        struct byte_order_swapper<8> {
+            typedef uint64_t type;
+
+            static type swap(const type v) {
+#if _WIN32
+                return _byteswap_uint64(v);
+#else
+                return __builtin_bswap64(v);
+#endif
             }
+        };
+
+        // 经内存拷贝完成类型转换, 因此浮点类型同样适用
+        template<class T>
+        inline T change_byte_order(const T &t) {
+            typename byte_order_swapper<sizeof ( T)>::type v;
+            memcpy(&v, &t, sizeof ( T));
+            v = byte_order_swapper<sizeof ( T)>::swap(v);
+            T dst;
+            memcpy(&dst, &v, sizeof ( T));
             return dst;
         }
-        uint32_t htonl(const uint32_t l);
-        unsigned short htons(const uint16_t s);
-        uint32_t ntohl(const uint32_t l);
-        unsigned short ntohs(const uint16_t s);
+
+        // 批量转换 @count 个宽度为 @width(1/2/4/8) 字节的元素, 从 @src 写入 @dst, @dst 可以和 @src 相同
+        // 运行时根据CPU支持情况选择 AVX2/SSSE3 字节重排或标量实现, 其他宽度(long double)原样拷贝
+        void change_byte_order(void *dst, const void *src, std::size_t count, std::size_t width);
+
+        inline uint32_t htonl(const uint32_t l) {
+            return change_byte_order<uint32_t>(l);
+        }
+
+        inline unsigned short htons(const uint16_t s) {
+            return change_byte_order<unsigned short>(s);
+        }
+
+        inline uint32_t ntohl(const uint32_t l) {
+            return htonl(l);
+        }
+
+        inline unsigned short ntohs(const uint16_t s) {
+            return htons(s);
+        }
 
         template<class T>
         T *trim_space(const T *inputString, T * outputString, std::size_t cch);